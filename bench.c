@@ -0,0 +1,135 @@
+/**
+   @file bench.c
+   @author Louis Warner (elwarner)
+   This program measures how many steps per second the explorer engine runs when embedded through
+   libexplorer.a, and compares that with the command-line explorer doing the same work. It builds a
+   random square world, explores all of it, and times the run three ways: embedded with no rendering,
+   embedded with text frames written to /dev/null, and ./explorer with its output sent to /dev/null.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "map.h"
+#include "explorer.h"
+
+//Name of the world file written for the run.
+#define WORLD_FILE "bench_world.txt"
+
+//Steps counted by the frame sinks.
+long steps = 0;
+
+//Where the text sink writes.
+FILE *sink;
+
+/**
+   Gives the time since some fixed point, in seconds.
+   @return double now - the time
+ */
+double now(){
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+   Frame sink that only counts frames.
+   @param void *context - unused
+   @param const ExplorerView *view - the frame
+ */
+void countFrame( void *context, const ExplorerView *view ){
+  steps++;
+}
+
+/**
+   Frame sink that counts frames and prints them as text, like the command-line explorer.
+   @param void *context - unused
+   @param const ExplorerView *view - the frame
+ */
+void textFrame( void *context, const ExplorerView *view ){
+  steps++;
+  printGrid( sink, view->grid, view->stride, view->rows, view->cols );
+}
+
+/**
+   Writes a random world with walls on the edges and about a quarter of the inside walled off.
+   @param int size - width and height of the world
+ */
+void writeWorld( int size ){
+  FILE *fp = fopen( WORLD_FILE, "w" );
+  if( !fp ){
+    fprintf( stderr, "Can't write %s\n", WORLD_FILE );
+    exit( 1 );
+  }
+  srand( 1 );
+  for( int i = 0; i < size; i++ ){
+    for( int j = 0; j < size; j++ ){
+      if( i == size / 2 && j == size / 2 ){
+        putc( '^', fp );
+      } else if( i == 0 || j == 0 || i == size - 1 || j == size - 1 || rand() % 4 == 0 ){
+        putc( '#', fp );
+      } else {
+        putc( '.', fp );
+      }
+    }
+    putc( '\n', fp );
+  }
+  fclose( fp );
+}
+
+/**
+   Explores the world through the library, and reports the speed.
+   @param char *label - name for the run
+   @param ExplorerSinks *sinks - where frames go
+   @return long steps - how many steps the exploration took
+ */
+long runEmbedded( char *label, ExplorerSinks *sinks ){
+  ExplorerSession *session = explorerCreate( sinks );
+  FILE *fp = fopen( WORLD_FILE, "r" );
+  explorerLoadWorld( session, fp );
+  fclose( fp );
+  steps = 0;
+  double start = now();
+  explorerExplore( session, -1 );
+  double seconds = now() - start;
+  explorerFree( session );
+  printf( "%-24s %9ld steps %8.3f s %12.0f steps/s\n", label, steps, seconds, steps / seconds );
+  return steps;
+}
+
+/**
+   The main program runs the three measurements on a world of the size given on the command line.
+   @param argc - count of command line arguments
+   @param *argv[] - array of command line arguments
+   @return exit statues - either successful or unsuccessful
+ */
+int main( int argc, char *argv[] ){
+  int size = argc > 1 ? atoi( argv[1] ) : 200;
+  if( argc > 2 || size < 3 ){
+    fprintf( stderr, "usage: bench [world_size]\n" );
+    exit( 1 );
+  }
+  writeWorld( size );
+
+  //Embedded, first without rendering and then printing text frames like the explorer does.
+  ExplorerSinks counting = { countFrame, NULL, NULL };
+  long total = runEmbedded( "library, no rendering", &counting );
+  sink = fopen( "/dev/null", "w" );
+  ExplorerSinks printing = { textFrame, NULL, NULL };
+  runEmbedded( "library, text frames", &printing );
+  fclose( sink );
+
+  //The command-line explorer, doing the same exploration (the frame count is the same).
+  double start = now();
+  if( system( "echo explore | ./explorer --world " WORLD_FILE " > /dev/null" ) != 0 ){
+    fprintf( stderr, "Can't run ./explorer\n" );
+    remove( WORLD_FILE );
+    exit( 1 );
+  }
+  double seconds = now() - start;
+  printf( "%-24s %9ld steps %8.3f s %12.0f steps/s\n", "explorer command", total, seconds, total / seconds );
+
+  remove( WORLD_FILE );
+  exit( 0 );
+}
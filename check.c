@@ -0,0 +1,345 @@
+/**
+   @file check.c
+   @author Louis Warner (elwarner)
+   This file checks whole movement scripts without running them. The script is classified a
+   block at a time into 64-bit masks (newlines, token separators, sight sequence characters, null
+   characters), with SSE2 where the compiler has it, and each line is then checked from those
+   masks: tokens are runs of non-separator bits, a sight sequence is three set bits in the sight
+   mask, and a keyword is one 64-bit comparison.
+ */
+#include <stdint.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "explorer.h"
+
+//Characters covered by the masks, one bit each in a 64-bit word.
+#define BLOCK 64
+
+//Characters classified at a time. The new ones slide into the top of the masks, so any line short
+//enough to be valid that ends among them has all of its characters in the masks.
+#define STEP ( BLOCK - EXPLORER_LINE_LIMIT )
+
+//Script keywords, in the order of the packed words in Grammar.
+#define FORWARD 0
+#define LEFT 1
+#define RIGHT 2
+#define EXPLORE 3
+#define STATS 4
+#define QUIT 5
+#define KEYWORDS 6
+
+//Longest keyword.
+#define KEYWORD_LIMIT 7
+
+//Longest explore budget, in digits.
+#define BUDGET_LIMIT 9
+
+//Character classes of the last BLOCK characters classified, bit i standing for character i.
+typedef struct {
+  uint64_t newline;
+  uint64_t space;
+  uint64_t sight;
+  uint64_t end;
+} Masks;
+
+//What the checker knows about the script so far: the same things the session tracks that decide
+//whether a line is valid.
+typedef struct {
+  int world;
+  int started;
+  int checkStart;
+  int quit;
+  const unsigned char *limit;
+  uint64_t keywords[KEYWORDS + 1];
+  int byLength[KEYWORD_LIMIT + 1][2];
+  int moves[KEYWORD_LIMIT + 1];
+  uint64_t keep[KEYWORD_LIMIT + 1];
+} Grammar;
+
+/**
+   Gives the position of the lowest set bit.
+   @param uint64_t bits - the bits, not all 0
+   @return int position - position of the lowest set bit
+ */
+static int lowestBit( uint64_t bits ){
+#ifdef __GNUC__
+  return __builtin_ctzll( bits );
+#else
+  int position = 0;
+  while( !( bits & 1 ) ){
+    bits >>= 1;
+    position++;
+  }
+  return position;
+#endif
+}
+
+/**
+   Gives a mask of the lowest bits.
+   @param int length - number of bits, less than 64
+   @return uint64_t mask - the mask
+ */
+static uint64_t lowBits( int length ){
+  return ( (uint64_t) 1 << length ) - 1;
+}
+
+/**
+   Classifies the next STEP characters of the script, sliding them into the top of the masks.
+   @param const unsigned char *block - STEP characters
+   @param Masks *masks - the masks, updated
+ */
+static void classify( const unsigned char *block, Masks *masks ){
+  masks->newline >>= STEP;
+  masks->space >>= STEP;
+  masks->sight >>= STEP;
+  masks->end >>= STEP;
+#ifdef __SSE2__
+  for( int i = 0; i < STEP; i += 16 ){
+    __m128i x = _mm_loadu_si128( (const __m128i *) ( block + i ) );
+    __m128i space = _mm_or_si128( _mm_cmpeq_epi8( x, _mm_set1_epi8( ' ' ) ),
+                                  _mm_or_si128( _mm_cmpeq_epi8( x, _mm_set1_epi8( '\t' ) ),
+                                                _mm_cmpeq_epi8( x, _mm_set1_epi8( '\r' ) ) ) );
+    //Signed comparisons, so characters above 127 are below every range.
+    __m128i letter = _mm_and_si128( _mm_cmpgt_epi8( x, _mm_set1_epi8( 'a' - 1 ) ),
+                                    _mm_cmplt_epi8( x, _mm_set1_epi8( 'z' + 1 ) ) );
+    __m128i sight = _mm_or_si128( letter, _mm_or_si128( _mm_cmpeq_epi8( x, _mm_set1_epi8( '.' ) ),
+                                                        _mm_cmpeq_epi8( x, _mm_set1_epi8( '#' ) ) ) );
+    int shift = BLOCK - STEP + i;
+    masks->newline |= (uint64_t) _mm_movemask_epi8( _mm_cmpeq_epi8( x, _mm_set1_epi8( '\n' ) ) ) << shift;
+    masks->space |= (uint64_t) _mm_movemask_epi8( space ) << shift;
+    masks->sight |= (uint64_t) _mm_movemask_epi8( sight ) << shift;
+    masks->end |= (uint64_t) _mm_movemask_epi8( _mm_cmpeq_epi8( x, _mm_setzero_si128() ) ) << shift;
+  }
+#else
+  for( int i = 0; i < STEP; i++ ){
+    unsigned char c = block[i];
+    uint64_t bit = (uint64_t) 1 << ( BLOCK - STEP + i );
+    masks->newline |= c == '\n' ? bit : 0;
+    masks->space |= c == ' ' || c == '\t' || c == '\r' ? bit : 0;
+    masks->sight |= c == '.' || c == '#' || ( c >= 'a' && c <= 'z' ) ? bit : 0;
+    masks->end |= c == '\0' ? bit : 0;
+  }
+#endif
+}
+
+/**
+   Packs up to 8 characters into a 64-bit word, zero padded, so words can be compared in one go.
+   Away from the end of the script all 8 are loaded at once and the extra ones masked off.
+   @param Grammar *g - the grammar, with the masks that keep the first characters of a word
+   @param const unsigned char *text - the characters
+   @param int length - number of characters, at most KEYWORD_LIMIT
+   @return uint64_t word - the packed characters
+ */
+static uint64_t pack( Grammar *g, const unsigned char *text, int length ){
+  uint64_t word = 0;
+  if( g->limit - text >= 8 ){
+    memcpy( &word, text, 8 );
+    return word & g->keep[length];
+  }
+  memcpy( &word, text, length );
+  return word;
+}
+
+/**
+   Finds which keyword a token is. There are at most two keywords of any length, so the token is
+   compared with just those. Tokens never hold a null character, so equal packed words mean equal
+   lengths as well.
+   @param Grammar *g - the grammar, with the packed keywords
+   @param const unsigned char *token - the token
+   @param int length - length of the token
+   @return int keyword - the keyword, or KEYWORDS if it is not one
+ */
+static int keyword( Grammar *g, const unsigned char *token, int length ){
+  if( length > KEYWORD_LIMIT ){
+    return KEYWORDS;
+  }
+  uint64_t word = pack( g, token, length );
+  int first = g->byLength[length][0];
+  int second = g->byLength[length][1];
+  return word == g->keywords[first] ? first : word == g->keywords[second] ? second : KEYWORDS;
+}
+
+/**
+   Checks for a valid explore budget: a positive number of at most BUDGET_LIMIT digits.
+   @param const unsigned char *token - the token
+   @param int length - length of the token
+   @return int valid - 0 for false or 1 for true
+ */
+static int isBudget( const unsigned char *token, int length ){
+  int positive = 0;
+  if( length > BUDGET_LIMIT ){
+    return 0;
+  }
+  for( int i = 0; i < length; i++ ){
+    if( token[i] < '0' || token[i] > '9' ){
+      return 0;
+    }
+    positive |= token[i] != '0';
+  }
+  return positive;
+}
+
+/**
+   Checks one line, following the same rules as explorerLine.
+   @param Grammar *g - the grammar, updated by the line
+   @param const unsigned char *line - the line
+   @param int length - length of the line
+   @param uint64_t word - characters of the line that are not separators
+   @param uint64_t sight - characters of the line that can be in a sight sequence
+   @return int valid - 0 for false or 1 for true
+ */
+static int checkLine( Grammar *g, const unsigned char *line, int length, uint64_t word, uint64_t sight ){
+  int starts[3];
+  int lengths[3];
+  int count = 0;
+
+  //Most lines are a move or turn with its sight sequence ("left ..#"), which is valid once the map
+  //has started: a keyword, one separator, then three sight characters ending the line.
+  int move = length - 4;
+  if( move >= 0 && move <= KEYWORD_LIMIT && g->started && !g->checkStart &&
+      word == ( lowBits( length ) & ~( (uint64_t) 1 << move ) ) && ( sight >> ( move + 1 ) & 7 ) == 7 ){
+    int k = g->moves[move];
+    if( k != KEYWORDS && pack( g, line, move ) == g->keywords[k] ){
+      return 1;
+    }
+  }
+
+  //Tokens start where a non-separator follows a separator; a third token makes the line invalid.
+  uint64_t begin = word & ~( word << 1 );
+  while( begin && count < 3 ){
+    starts[count] = lowestBit( begin );
+    lengths[count] = lowestBit( ~( word >> starts[count] ) );
+    begin &= begin - 1;
+    count++;
+  }
+  if( count == 0 ){
+    return 1;
+  }
+  if( count > 2 ){
+    return 0;
+  }
+  int hasSight = count == 2 && lengths[1] == 3;
+  int firstSight = count == 1 && lengths[0] == 3 && ( ( sight >> starts[0] ) & 7 ) == 7;
+
+  //Nothing else is accepted until the map has its initial sight sequence.
+  if( !g->started ){
+    g->started = firstSight;
+    return firstSight;
+  }
+
+  //In world mode a script may still begin with the initial sequence.
+  if( g->checkStart ){
+    g->checkStart = 0;
+    if( firstSight ){
+      return 1;
+    }
+  }
+
+  int k = keyword( g, line + starts[0], lengths[0] );
+  if( count == 2 && !hasSight && k != EXPLORE ){
+    return 0;
+  }
+  if( k == FORWARD || k == LEFT || k == RIGHT ){
+    return hasSight ? ( ( sight >> starts[1] ) & 7 ) == 7 : g->world;
+  } else if( k == EXPLORE && g->world ){
+    return count == 1 || isBudget( line + starts[1], lengths[1] );
+  } else if( k == STATS && count == 1 ){
+    return 1;
+  } else if( k == QUIT && count == 1 ){
+    g->quit = 1;
+    return 1;
+  }
+  return 0;
+}
+
+/**
+   This function finds every line of a movement script that the explorer would reject with
+   "Invalid command", without running it. Since that only depends on how the lines are written,
+   this is exactly the set of lines a run would reject (a run may also report "Blocked" or
+   "Inconsistent map", which depend on the map). Lines after a quit command are never run, so they
+   are not checked.
+   @param const char *text - the script, which need not be null terminated
+   @param long size - number of characters in the script
+   @param int world - 1 if the script is for --world mode, otherwise 0
+   @param void (*report)( void *context, long line ) - called with the number (counting from 1) of each invalid line, in order, or NULL
+   @param void *context - passed to report
+   @return long count - number of invalid lines
+ */
+long explorerCheck( const char *text, long size, int world, void (*report)( void *context, long line ), void *context ){
+  const unsigned char *script = (const unsigned char *) text;
+  static const char *names[KEYWORDS] = { "forward", "left", "right", "explore", "stats", "quit" };
+  Grammar g;
+  Masks masks = { 0, 0, 0, 0 };
+  unsigned char edge[STEP];
+  long lineStart = 0;
+  long lineNumber = 1;
+  long count = 0;
+  int unterminated = size > 0 && script[size - 1] != '\n';
+
+  //Set up the grammar, with each keyword packed and filed under its length (moves separately).
+  //The extra keyword slot holds a word no token packs to.
+  g.world = g.started = g.checkStart = world;
+  g.quit = 0;
+  g.limit = script + size;
+  for( int length = 0; length <= KEYWORD_LIMIT; length++ ){
+    unsigned char bytes[8] = { 0 };
+    memset( bytes, 0xFF, length );
+    memcpy( &g.keep[length], bytes, 8 );
+    g.byLength[length][0] = g.byLength[length][1] = g.moves[length] = KEYWORDS;
+  }
+  g.keywords[KEYWORDS] = ~(uint64_t) 0;
+  for( int k = 0; k < KEYWORDS; k++ ){
+    int length = strlen( names[k] );
+    g.keywords[k] = 0;
+    memcpy( &g.keywords[k], names[k], length );
+    g.byLength[length][g.byLength[length][0] != KEYWORDS] = k;
+    if( k == FORWARD || k == LEFT || k == RIGHT ){
+      g.moves[length] = k;
+    }
+  }
+
+  //Check each line as its newline turns up. The end of an unterminated last line is handled as
+  //one more newline.
+  for( long base = 0; ( base < size || ( base == size && unterminated ) ) && !g.quit; base += STEP ){
+    long first = base + STEP - BLOCK;
+    if( size - base >= STEP ){
+      classify( script + base, &masks );
+    } else {
+      //At the end of the script, classify a copy padded with null characters.
+      memset( edge, 0, STEP );
+      memcpy( edge, script + base, size - base );
+      classify( edge, &masks );
+      if( unterminated ){
+        masks.newline |= (uint64_t) 1 << ( size - first );
+      }
+    }
+    uint64_t newlines = masks.newline >> ( BLOCK - STEP );
+    while( newlines && !g.quit ){
+      long lineEnd = base + lowestBit( newlines );
+      newlines &= newlines - 1;
+      int valid = 0;
+      if( lineEnd - lineStart <= EXPLORER_LINE_LIMIT ){
+        //Anything after a null character is dropped, as it is when the line is read as a string.
+        int offset = lineStart - first;
+        int length = lineEnd - lineStart;
+        uint64_t end = ( masks.end >> offset ) & lowBits( length );
+        if( end ){
+          length = lowestBit( end );
+        }
+        valid = checkLine( &g, script + lineStart, length, ~( masks.space >> offset ) & lowBits( length ),
+                           masks.sight >> offset );
+      }
+      if( !valid ){
+        count++;
+        if( report ){
+          report( context, lineNumber );
+        }
+      }
+      lineStart = lineEnd + 1;
+      lineNumber++;
+    }
+  }
+  return count;
+}
@@ -7,558 +7,633 @@
    '.' character or spaces filled by lower-case letters (items). '#' represents a wall that cannot be passed through.
    Spaces the player has not yet seen are represented by ' ', and the map edges are represented with '+' on the corners
    and '-' on the edges. The current map will be printed after every valid move.
+   The map itself is kept by the engine in libexplorer.a (see explorer.h); this program reads scripts,
+   runs them through a session and prints what it reports.
  */
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "map.h"
- 
-//Variables for number of rows (set by map initialization) and columns (set to constant).
-int rows;
-int oldrows;
-int cols = INITIAL_MAP_SIZE;
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "explorer.h"
+#include "frame.h"
 
-//Declaration for the map, initialized in build phase.
-char **map = NULL;
-char **savemap = NULL;
+//Usage message, printed after any problem with the command line or the files named on it.
+#define USAGE "usage: explorer [--world world_file] [--format=text|bin] [script_file]\n" \
+              "       explorer [--world world_file] [--format=text|bin] --batch script_file...\n" \
+              "       explorer [--world world_file] --check [script_file]\n"
 
-//Player always begins facing north, at the center of the array.
-int dir = NORTH;
-int rowPos = 1;
-int colPos = 1;
+//Node of the batch trie. Each node is one script line, shared by every script that starts the same way.
+typedef struct NodeStruct {
+  char *line;
+  int length;
+  struct NodeStruct *parent;
+  struct NodeStruct *child;
+  struct NodeStruct *sibling;
+  int marked;
+  int finished;
+  long outStart;
+  long outEnd;
+  long errStart;
+  long errEnd;
+} Node;
 
-//The last space the player was on.
-char last = ' ';
+//Hash table of trie nodes by parent and line, so finding a child takes the same time however many there are.
+typedef struct {
+  Node **slots;
+  long capacity;
+  long count;
+} Children;
+
+//Where frames and error messages are written: standard output and standard error, except in batch mode.
+FILE *frames;
+FILE *messages;
+
+//Whether frames are written in the binary format (--format=bin), and the buffer they are built in if so.
+int binary = 0;
+Frame lastFrame;
 
 
 /**
-   Checks for a valid line of sight for the character.
-   @param String this - max of 4 characters (3 and a null terminator)
-   @return int valid - 0 for false or 1 for true
+   Frame sink that prints the map as a text frame.
+   @param void *context - unused
+   @param const ExplorerView *view - the frame
  */
-int isValidSequence(char this[4]){
-  //Set valid to 1 (true).
-  int valid = 1;
-  //Check all characters except the null terminator.
-  for(int i = 0; i < 3; i ++){
-    //Check if it is a valid common character. If not, set valid to 0 (false).
-    if(this[i] != '.' && this[i] != '#'){
-       valid = 0;
-    }
-    //If the first test failed, but the character is actually a valid lowercase letter this will set valid back to 1 (true).
-    if(this[i] >= 97 && this[i] <= 122){
-       valid = 1;
-    }
+void textFrame(void *context, const ExplorerView *view){
+  printGrid(frames, view->grid, view->stride, view->rows, view->cols);
+}
+
+
+/**
+   Gives up when a frame buffer can't be grown.
+ */
+void outOfMemory(){
+  fprintf(stderr, "Out of memory\n");
+  exit (1);
+}
+
+
+/**
+   Frame sink that writes the map as a binary record.
+   @param void *context - unused
+   @param const ExplorerView *view - the frame
+ */
+void binaryFrame(void *context, const ExplorerView *view){
+  int status = writeFrame(frames, &lastFrame, view);
+  if(status == FRAME_TOO_LARGE){
+    fprintf(stderr, "Map too large for binary frames\n");
+    exit (1);
+  } else if(status == FRAME_NO_MEMORY){
+    outOfMemory();
   }
-  return valid;  
 }
 
 
 /**
-   Checks for a valid forward movement by determining whether a wall is in the way.
-   @return int valid - 0 for false or 1 for true
+   Statistics sink for the stats command, as text or as a binary record depending on the output format.
+   @param void *context - unused
+   @param const MapStats *stats - the statistics
  */
-int validForward(){
-  int valid = 1;
-  if(dir == NORTH){
-    if(map[rowPos - 1][colPos] == '#'){
-      valid = 0;
-    }
+void showStats(void *context, const MapStats *stats){
+  MapStats copy = *stats;
+  if(binary){
+    writeStats(frames, &copy);
+  } else {
+    printStats(frames, &copy);
   }
-  if(dir == SOUTH){
-    if(map[rowPos + 1][colPos] == '#'){
-      valid = 0;
-    }
+}
+
+
+/**
+   Prints the message for a command that did not go through.
+   @param int status - status reported by the session
+ */
+void report(int status){
+  if(status == EXPLORER_BLOCKED){
+    fprintf(messages, "Blocked\n");
+  } else if(status == EXPLORER_INVALID){
+    fprintf(messages, "Invalid command\n");
+  } else if(status == EXPLORER_INCONSISTENT){
+    fprintf(messages, "Inconsistent map\n");
   }
-  if(dir == EAST){
-    if(map[rowPos][colPos + 1] == '#'){
-      valid = 0;
-    }
+}
+
+
+/**
+   Runs one script line, reporting any problem.
+   @param ExplorerSession *session - the session
+   @param char *line - the line
+   @param int length - length of the line as read, which may be more than EXPLORER_LINE_LIMIT
+   @return int more - 0 if the script asked to quit, otherwise 1
+ */
+int runLine(ExplorerSession *session, char *line, int length){
+  int status = length > EXPLORER_LINE_LIMIT ? EXPLORER_INVALID : explorerLine(session, line);
+  report(status);
+  return status != EXPLORER_QUIT;
+}
+
+
+/**
+   Reads one line of a script. Characters past EXPLORER_LINE_LIMIT are dropped, but still counted so
+   the caller can reject the line.
+   @param FILE *input - the script
+   @param char *line - buffer of at least EXPLORER_LINE_LIMIT + 1 characters
+   @return int length - number of characters on the line, or EOF at the end of the script
+ */
+int readLine(FILE *input, char *line){
+  int length = 0;
+  int c = getc(input);
+  if(c == EOF){
+    return EOF;
   }
-  if(dir == WEST){
-    if(map[rowPos][colPos - 1] == '#'){
-      valid = 0;
+  while(c != EOF && c != '\n'){
+    if(length < EXPLORER_LINE_LIMIT){
+      line[length] = c;
     }
+    length++;
+    c = getc(input);
   }
-  return valid;
+  line[length < EXPLORER_LINE_LIMIT ? length : EXPLORER_LINE_LIMIT] = '\0';
+  return length;
 }
 
 
 /**
-   Makes an attempt at moving forward. If the player is going to a map edge,
-   the map is expanded to make room for the new strings. The map state is saved
-   before attempting the move, and will revert to the saved state if an illegal
-   move is attempted.
-   @param string this - the sequence of chars the user sees after a forward move
+   This program builds the map from a movement script, one line at a time.
+   @param ExplorerSession *session - the session
+   @param FILE *input - the script (a file or standard input)
  */
-void moveForward(char this[4]){
-  //Integer for whether or not an expansion has occurred.
-  int expansion = 0;
-  
-  //Save map state.
-  savemap = copyMap(map, savemap, rows, oldrows); 
-  oldrows = rows;
-  
-  //Save current user space.
-  map[rowPos][colPos] = last;
-  
-  //Check direction
-  if(dir == NORTH){
-    
-    //Make a move, save new char into last.
-    rowPos--;
-    last = map[rowPos][colPos];
-    
-    //Check if an expansion is needed.
-    if(rowPos == 0){
-      map = expandMap( map, &rows, 1, 0, 1, 0 );
-      expansion++;
-      rowPos++;
-    }
-    //Procedure for making a northward move.
-    for(int i = 0; i < 3; i++){
-      if(map[rowPos - 1][colPos - 1 + i] == ' ' || map[rowPos - 1][colPos - 1 + i] == this[i]){
-        map[rowPos - 1][colPos - 1 + i] = this[i];
-      } else {
-        fprintf(stderr, "Inconsistent map\n");        
-        map = copyMap(savemap, map, oldrows, rows);
-        if(expansion){
-          rows = oldrows;
-          expansion--;
-        }
-        rowPos++;      
-        last = map[rowPos][colPos];
-        return;
-      }
-    }
-    if(expansion){
-      expansion--;
-    }
-    
-    //Check direction
-  } else if(dir == SOUTH){
-    rowPos++;
-    last = map[rowPos][colPos];
-    
-    //Check if an expansion is needed.
-    if(rowPos == rows - 1){
-      map = expandMap( map, &rows, 1, 0, 0, 0 );  
-      expansion++;
-    }
-    //Procedure for making a southward move.
-    for(int i = 0; i < 3; i++){
-      if(map[rowPos + 1][colPos + 1 - i] == ' ' || map[rowPos + 1][colPos + 1 - i] == this[i]){
-        map[rowPos + 1][colPos + 1 - i] = this[i];
-      } else {
-        fprintf(stderr, "Inconsistent map\n");       
-        map = copyMap(savemap, map, oldrows, rows);
-        if(expansion){
-          rows = oldrows;
-          expansion--;
-        }
-        rowPos--;  
-        last = map[rowPos][colPos];
-        return;
-      }      
-    }
-    if(expansion){
-      expansion--;
-    }
-    
-  //Check direction
-  } else if(dir == EAST){
-    colPos++;
-    last = map[rowPos][colPos];
-    
-    //Check if an expansion is needed.
-    if(colPos == cols - 1){
-      map = expandMap( map, &rows, 0, 1, 0, 0 );
-      cols++;
-    }
-    //Procedure for making an eastward move.
-    for(int i = 0; i < 3; i++){
-      if(map[rowPos - 1 + i][colPos + 1] == ' ' || map[rowPos - 1 + i][colPos + 1] == this[i]){
-        map[rowPos - 1 + i][colPos + 1] = this[i];
-      } else {
-        fprintf(stderr, "Inconsistent map\n");
-        map = copyMap(savemap, map, oldrows, rows);
-        colPos--;
-        last = map[rowPos][colPos];
-        return;        
-      }
-    }
-  
-  //Check direction
-  } else if(dir == WEST){
-    colPos--;
-    last = map[rowPos][colPos];
-    
-    //Check if an expansion is needed.
-    if(colPos == 0){
-      map = expandMap( map, &rows, 0, 1, 0, 1 ); 
-      colPos++;
-      cols++;
-    }
-    //Procedure for making a westward move.
-    for(int i = 0; i < 3; i++){
-      if(map[rowPos + 1 - i][colPos - 1] == ' ' || map[rowPos + 1 - i][colPos - 1] == this[i]){
-        map[rowPos + 1 - i][colPos - 1] = this[i];
-      } else {
-        fprintf(stderr, "Inconsistent map\n");
-        map = copyMap(savemap, map, oldrows, rows);
-        colPos++;
-        last = map[rowPos][colPos];
-        return;
-      }
+void buildFromFile(ExplorerSession *session, FILE *input){
+  //Buffer for the next line. It is large enough for any valid command and a null terminator.
+  char line[EXPLORER_LINE_LIMIT + 1];
+  int length;
+
+  //Read and process commands until the script ends or quits.
+  while((length = readLine(input, line)) != EOF){
+    if(!runLine(session, line, length)){
+      break;
     }
   }
-  
-  //Display the map.
-  showMap(map, rows, rowPos, colPos, dir);
 }
 
+
 /**
-   Makes an attempt to turn left.
-   @param string this - the sequence the player sees after a successful turn
+   Loads the world for --world mode, which starts the map from the player's view in it.
+   @param ExplorerSession *session - the session
+   @param char *name - name of the world file
  */
-void turnLeft(char this[4]){
-  //Save current state
-  savemap = copyMap(map, savemap, rows, oldrows); 
-  oldrows = rows;
-  
-  //Check direction
-  if(dir == NORTH){
-    dir = WEST;
-    for(int i = 0; i < 3; i++){
-      if(map[rowPos + 1 - i][colPos - 1] == ' ' || map[rowPos + 1 - i][colPos - 1] == this[i]){
-        map[rowPos + 1 - i][colPos - 1] = this[i];
-      } else {
-        fprintf(stderr, "Inconsistent map");
-        map = copyMap(savemap, map, oldrows, rows);
-        dir = NORTH;
-        return;
-      }
-    }
-  //Check direction
-  } else if(dir == SOUTH){
-    dir = EAST;
-    for(int i = 0; i < 3; i++){
-      if(map[rowPos - 1 + i][colPos + 1] == ' ' || map[rowPos - 1 + i][colPos + 1] == this[i]){
-        map[rowPos - 1 + i][colPos + 1] = this[i];
-      } else {
-        fprintf(stderr, "Inconsistent map");
-        map = copyMap(savemap, map, oldrows, rows);
-        dir = SOUTH;
-        return;
-      }
-    }
-  //Check direction
-  } else if(dir == EAST){
-    dir = NORTH;
-    for(int i = 0; i < 3; i++){
-      if(map[rowPos - 1][colPos - 1 + i] == ' ' || map[rowPos - 1][colPos - 1 + i] == this[i]){
-        map[rowPos - 1][colPos - 1 + i] = this[i];
-      } else {
-        fprintf(stderr, "Inconsistent map");
-        map = copyMap(savemap, map, oldrows, rows);
-        dir = EAST;
-        return;
-      }
-    }
-  //Check direction
-  } else if(dir == WEST){
-    dir = SOUTH;
-    for(int i = 0; i < 3; i++){
-      if(map[rowPos + 1][colPos + 1 - i] == ' ' || map[rowPos + 1][colPos + 1 - i] == this[i]){
-        map[rowPos + 1][colPos + 1 - i] = this[i];
-      } else {
-        fprintf(stderr, "Inconsistent map");
-        map = copyMap(savemap, map, oldrows, rows);
-        dir = WEST;
-        return;
-      }
-    }
+void startWorld(ExplorerSession *session, char *name){
+  FILE *fp = fopen(name, "r");
+  if( !fp ){
+    fprintf(stderr, "Can't open world file: %s\n" USAGE, name);
+    exit (1);
+  }
+  int status = explorerLoadWorld(session, fp);
+  fclose(fp);
+  if(status != EXPLORER_OK){
+    fprintf(stderr, "Invalid world file: %s\n", name);
+    exit (1);
   }
-  //Display the map.
-  showMap(map, rows, rowPos, colPos, dir);
 }
 
+
 /**
-   Makes an attempt to turn right.
-   @param string this - the sequence the player sees after a successful turn
+   Reports an invalid line found by --check.
+   @param void *context - unused
+   @param long line - number of the line
  */
-void turnRight(char this[4]){  
-  //Save current state
-  savemap = copyMap(map, savemap, rows, oldrows);
-  oldrows = rows;
-  
-  //Check direction
-  if(dir == NORTH){
-    dir = EAST;
-    for(int i = 0; i < 3; i++){
-      if(map[rowPos - 1 + i][colPos + 1] == ' ' || map[rowPos - 1 + i][colPos + 1] == this[i]){
-        map[rowPos - 1 + i][colPos + 1] = this[i];
-      } else {
-        fprintf(stderr, "Inconsistent map");
-        map = copyMap(savemap, map, oldrows, rows);
-        dir = NORTH;
-        return;
-      }
-    }
-  //Check direction
-  } else if(dir == SOUTH){
-    dir = WEST;
-    for(int i = 0; i < 3; i++){
-      if(map[rowPos + 1 - i][colPos - 1] == ' ' || map[rowPos + 1 - i][colPos - 1] == this[i]){
-        map[rowPos + 1 - i][colPos - 1] = this[i];
-      } else {
-        fprintf(stderr, "Inconsistent map");
-        map = copyMap(savemap, map, oldrows, rows);
-        dir = SOUTH;
-        return;
-      }
-    }
-  //Check direction
-  } else if(dir == EAST){
-    dir = SOUTH;
-    for(int i = 0; i < 3; i++){
-      if(map[rowPos + 1][colPos + 1 - i] == ' ' || map[rowPos + 1][colPos + 1 - i] == this[i]){
-        map[rowPos + 1][colPos + 1 - i] = this[i];
-      } else {
-        fprintf(stderr, "Inconsistent map");
-        map = copyMap(savemap, map, oldrows, rows);
-        dir = EAST;
-        return;
-      }
+void reportLine(void *context, long line){
+  fprintf(messages, "Invalid command on line %ld\n", line);
+}
+
+
+/**
+   Checks a whole script without running it (--check), reporting each line a run would reject as
+   an invalid command. A script in a regular file is mapped into memory; anything else is read in full.
+   @param FILE *input - the script (a file or standard input)
+   @param int world - 1 in --world mode, otherwise 0
+   @return long count - number of invalid lines
+ */
+long checkInput(FILE *input, int world){
+  struct stat info;
+  char *text = NULL;
+  long size = 0;
+  long count;
+
+  if( !fstat(fileno(input), &info) && S_ISREG(info.st_mode) && info.st_size > 0 ){
+    text = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fileno(input), 0);
+    if(text != MAP_FAILED){
+      posix_madvise(text, info.st_size, POSIX_MADV_SEQUENTIAL);
+      count = explorerCheck(text, info.st_size, world, reportLine, NULL);
+      munmap(text, info.st_size);
+      return count;
     }
-  //Check direction
-  } else if(dir == WEST){
-    dir = NORTH;
-    for(int i = 0; i < 3; i++){
-      if(map[rowPos - 1][colPos - 1 + i] == ' ' || map[rowPos - 1][colPos - 1 + i] == this[i]){
-        map[rowPos - 1][colPos - 1 + i] = this[i];
-      } else {
-        fprintf(stderr, "Inconsistent map");
-        map = copyMap(savemap, map, oldrows, rows);
-        dir = WEST;
-        return;
-      }
+  }
+
+  //Not a file that can be mapped, so read it into memory instead.
+  long capacity = 1 << 16;
+  size_t read;
+  text = (char *) malloc(capacity);
+  while((read = fread(text + size, 1, capacity - size, input)) > 0){
+    size += read;
+    if(size == capacity){
+      capacity *= 2;
+      text = (char *) realloc(text, capacity);
     }
   }
-  //Display the map.
-  showMap(map, rows, rowPos, colPos, dir);
+  count = explorerCheck(text, size, world, reportLine, NULL);
+  free(text);
+  return count;
 }
 
 
+/**
+   Gives the slot where a child with the given parent and line belongs in the hash table: either
+   the slot holding it, or the empty slot where it would go.
+   @param Children *children - the table
+   @param Node *parent - the parent node
+   @param char *line - the child's line
+   @param int length - the child's line length, as readLine gave it
+   @return Node **slot - the slot
+ */
+Node **findChild(Children *children, Node *parent, char *line, int length){
+  unsigned long hash = 2166136261UL ^ (unsigned long) (size_t) parent ^ (unsigned long) length;
+  for(char *ch = line; *ch; ch++){
+    hash = (hash ^ (unsigned char) *ch) * 16777619UL;
+  }
+  long at = hash % children->capacity;
+  while(children->slots[at] && (children->slots[at]->parent != parent || children->slots[at]->length != length ||
+                                strcmp(children->slots[at]->line, line))){
+    at = (at + 1) % children->capacity;
+  }
+  return children->slots + at;
+}
 
 
 /**
-   This program is used if an input file is given for building the map.
-   @param FILE *input - the input file
+   Doubles the hash table of children, once it is half full.
+   @param Children *children - the table
  */
-void buildFromFile(FILE *input){
-  //Strings to hold the next command and sequence. They are large enough to hold valid strings and a null terminator.
-  char command[8];
-  char sequence[4];
+void growChildren(Children *children){
+  Node **slots = children->slots;
+  long capacity = children->capacity;
+  children->capacity *= 2;
+  children->slots = (Node **) calloc(children->capacity, sizeof(Node *));
+  for(long i = 0; i < capacity; i++){
+    if(slots[i]){
+      *findChild(children, slots[i]->parent, slots[i]->line, slots[i]->length) = slots[i];
+    }
+  }
+  free(slots);
+}
 
-  //Character helpful for discarding lines.
-  char c;
-  
-  //Initialize map and savemap.
-  map = initMap(&rows);
-  savemap = initMap(&oldrows);
-  
-  //Read initial map sequence
-  while(!feof(input)){
-    fscanf(input, "%4s", sequence);
-    if(isValidSequence(sequence)){
-      for(int i = 0; i < 3; i++){
-        map[rowPos - 1][colPos - 1 + i] = sequence[i];
+
+/**
+   Adds a script to the batch trie, sharing nodes with every script that starts with the same lines.
+   @param Node *root - root of the trie
+   @param Children *children - hash table of every node in the trie below the root
+   @param FILE *input - the script
+   @return Node *end - node for the last line of the script
+ */
+Node *addScript(Node *root, Children *children, FILE *input){
+  char line[EXPLORER_LINE_LIMIT + 1];
+  int length;
+  Node *node = root;
+  while((length = readLine(input, line)) != EOF){
+    Node **slot = findChild(children, node, line, length);
+    if(!*slot){
+      Node *child = (Node *) calloc(1, sizeof(Node));
+      child->line = (char *) malloc(strlen(line) + 1);
+      strcpy(child->line, line);
+      child->length = length;
+      child->parent = node;
+      child->sibling = node->child;
+      node->child = child;
+      *slot = child;
+      if(++children->count * 2 > children->capacity){
+        growChildren(children);
       }
-      savemap = copyMap(map, savemap, rows, oldrows);
-      showMap(map, rows, rowPos, colPos, dir);
-      break;
+      node = child;
     } else {
-      fprintf(stderr, "Invalid command\n");
-      c = getc(input);
-      while(c != '\n'){
-        c = getc(input);
-      }
+      node = *slot;
     }
   }
-  //Read and process commands
-  while(!feof(input)){
-    fscanf(input, "%8s", command);
-    if(!strncmp(command, "forward", 7)){
-      fscanf(input, "%4s", sequence);
-      if(isValidSequence(sequence)){
-        if(validForward()){
-          moveForward(sequence);
-        } else if (!validForward()){
-          fprintf(stderr, "Blocked\n");
-        }
-      } else {
-        fprintf(stderr, "Invalid command\n");
-        c = getc(input);
-        while(c != '\n'){
-          c = getc(input);
-        }
-      }
-    } else if(!strncmp(command, "right", 5)){
-      fscanf(input, "%4s", sequence);
-      if(isValidSequence(sequence)){
-        turnRight(sequence);
-      } else {
-        fprintf(stderr, "Invalid command\n");
-        c = getc(input);
-        while(c != '\n'){
-          c = getc(input);
-        }
+  return node;
+}
+
+
+/**
+   Runs the command for one trie node from the state its parent left, recording where its output went.
+   @param ExplorerSession *session - the session
+   @param Node *node - the node to run
+ */
+void runNode(ExplorerSession *session, Node *node){
+  node->outStart = ftell(frames);
+  node->errStart = ftell(messages);
+  node->finished = node->parent->finished;
+  if(!node->finished){
+    node->finished = !runLine(session, node->line, node->length);
+  }
+  node->outEnd = ftell(frames);
+  node->errEnd = ftell(messages);
+}
+
+
+/**
+   Runs every command in the trie once, in depth-first order. Where scripts part ways the session
+   is marked, and put back to the mark before each branch after the first, which undoes only what
+   the branch before it did.
+   @param ExplorerSession *session - the session
+   @param Node *root - root of the trie, already run
+ */
+void runTrie(ExplorerSession *session, Node *root){
+  Node *node = root;
+  while(1){
+    if(node->child){
+      if(node->child->sibling){
+        explorerMark(session);
+        node->marked = 1;
       }
-    } else if(!strncmp(command, "left", 4)){
-      fscanf(input, "%4s", sequence);
-      if(isValidSequence(sequence)){
-        turnLeft(sequence);
-      } else {
-        fprintf(stderr, "Invalid command\n");
-        c = getc(input);
-        while(c != '\n'){
-          c = getc(input);
+      node = node->child;
+    } else {
+      //Climb back to the nearest branch that still has scripts to run, dropping finished marks.
+      while(node != root && !node->sibling){
+        node = node->parent;
+        if(node->marked){
+          explorerDrop(session);
+          node->marked = 0;
         }
       }
-    } else if(!strncmp(command, "quit", 4)){
-      break;
-    } else{
-      fprintf(stderr, "Invalid command\n");
-      c = getc(input);
-      while(c != '\n'){
-        c = getc(input);
+      if(node == root){
+        return;
       }
+      explorerUndo(session);
+      node = node->sibling;
     }
+    runNode(session, node);
   }
-  return;
 }
 
 
 /**
-   This program is used to build the map from standard input.
+   Copies part of a captured output file to another stream.
+   @param FILE *from - the captured output
+   @param long start - offset of the first byte
+   @param long end - offset past the last byte
+   @param FILE *to - the stream to copy to
  */
-void buildFromStandard(){
-  //Strings to hold the next command and sequence. They are large enough to hold valid strings and a null terminator.
-  char command[8];
-  char sequence[4];
+void copyOutput(FILE *from, long start, long end, FILE *to){
+  char buffer[4096];
+  fseek(from, start, SEEK_SET);
+  while(start < end){
+    size_t count = fread(buffer, 1, end - start < sizeof(buffer) ? end - start : sizeof(buffer), from);
+    if(count == 0){
+      return;
+    }
+    fwrite(buffer, 1, count, to);
+    start += count;
+  }
+}
 
-  //Character helpful for discarding lines.
-  char c;
-  
-  //Initialize map and savemap.
-  map = initMap(&rows);
-  savemap = initMap(&oldrows);
-  
-  //Read initial map sequence
-  while(!feof(stdin)){
-    fscanf(stdin, "%4s", sequence);
-    if(isValidSequence(sequence)){
-      for(int i = 0; i < 3; i++){
-        map[rowPos - 1][colPos - 1 + i] = sequence[i];
-      }
-      savemap = copyMap(map, savemap, rows, oldrows);
-      showMap(map, rows, rowPos, colPos, dir);
-      break;
-    } else {
-      fprintf(stderr, "Invalid command\n");
-      c = getc(stdin);
-      while(c != '\n'){
-        c = getc(stdin);
-      }
+
+/**
+   Writes the output of one script, made up of the output of every node from the root to the
+   end of the script. Neighbouring pieces of output are copied in one go.
+   @param Node *end - node for the last line of the script
+   @param int depth - number of nodes from the root to end, inclusive
+   @param FILE *out - where the frames go
+   @param FILE *err - where the messages go
+ */
+void writeScript(Node *end, int depth, FILE *out, FILE *err){
+  Node **path = (Node **) malloc(depth * sizeof(Node *));
+  for(int i = depth - 1; i >= 0; i--){
+    path[i] = end;
+    end = end->parent;
+  }
+  long outStart = path[0]->outStart;
+  long outEnd = path[0]->outEnd;
+  long errStart = path[0]->errStart;
+  long errEnd = path[0]->errEnd;
+  for(int i = 1; i < depth; i++){
+    if(path[i]->outStart != outEnd){
+      copyOutput(frames, outStart, outEnd, out);
+      outStart = path[i]->outStart;
+    }
+    outEnd = path[i]->outEnd;
+    if(path[i]->errStart != errEnd){
+      copyOutput(messages, errStart, errEnd, err);
+      errStart = path[i]->errStart;
     }
+    errEnd = path[i]->errEnd;
   }
-  //Read and process commands
-  while(!feof(stdin)){
-    fscanf(stdin, "%8s", command);
-    if(!strncmp(command, "forward", 7)){
-      fscanf(stdin, "%4s", sequence);
-      if(isValidSequence(sequence)){
-        if(validForward()){
-          moveForward(sequence);
-        } else if (!validForward()){
-          fprintf(stderr, "Blocked\n");
-        }
-      } else {
-        fprintf(stderr, "Invalid command\n");
-        c = getc(stdin);
-        while(c != '\n'){
-          c = getc(stdin);
-        }
-      }
-    } else if(!strncmp(command, "right", 5)){
-      fscanf(stdin, "%4s", sequence);
-      if(isValidSequence(sequence)){
-        turnRight(sequence);
-      } else {
-        fprintf(stderr, "Invalid command\n");
-        c = getc(stdin);
-        while(c != '\n'){
-          c = getc(stdin);
-        }
-      }
-    } else if(!strncmp(command, "left", 4)){
-      fscanf(stdin, "%4s", sequence);
-      if(isValidSequence(sequence)){
-        turnLeft(sequence);
-      } else {
-        fprintf(stderr, "Invalid command\n");
-        c = getc(stdin);
-        while(c != '\n'){
-          c = getc(stdin);
-        }
-      }
-    } else if(!strncmp(command, "quit", 4)){
-      break;
-    } else{
-      fprintf(stderr, "Invalid command\n");
-      c = getc(stdin);
-      while(c != '\n'){
-        c = getc(stdin);
-      }
+  copyOutput(frames, outStart, outEnd, out);
+  copyOutput(messages, errStart, errEnd, err);
+  free(path);
+}
+
+
+/**
+   Opens one output file for batch mode, named after its script.
+   @param char *script - name of the script
+   @param char *suffix - ".out" or ".err"
+   @return FILE *fp - the open file
+ */
+FILE *openOutput(char *script, char *suffix){
+  char *name = (char *) malloc(strlen(script) + strlen(suffix) + 1);
+  strcpy(name, script);
+  strcat(name, suffix);
+  FILE *fp = fopen(name, "w");
+  if( !fp ){
+    fprintf(stderr, "Can't write batch output: %s\n", name);
+    exit (1);
+  }
+  free(name);
+  return fp;
+}
+
+
+/**
+   Frees a trie node and everything below it.
+   @param Node *node - the node to free
+ */
+void freeTrie(Node *node){
+  while(node){
+    Node *sibling = node->sibling;
+    freeTrie(node->child);
+    free(node->line);
+    free(node);
+    node = sibling;
+  }
+}
+
+
+/**
+   Runs a batch of scripts that share common prefixes. The scripts are merged into a trie of lines, each
+   distinct prefix is run only once, and each script's frames and messages are written to script.out and
+   script.err, exactly as separate runs would have produced them.
+   @param ExplorerSession *session - the session, not yet started
+   @param char *names[] - names of the scripts
+   @param int count - number of scripts
+   @param char *worldName - name of the world file, or NULL
+ */
+void runBatch(ExplorerSession *session, char *names[], int count, char *worldName){
+  Node *root = (Node *) calloc(1, sizeof(Node));
+  Children children = { (Node **) calloc(64, sizeof(Node *)), 64, 0 };
+  Node **ends = (Node **) malloc(count * sizeof(Node *));
+  int *depths = (int *) malloc(count * sizeof(int));
+
+  //Merge the scripts into the trie.
+  for(int i = 0; i < count; i++){
+    FILE *input = fopen(names[i], "r");
+    if( !input ){
+      fprintf(stderr, "Can't open movement script: %s\n" USAGE, names[i]);
+      exit (1);
+    }
+    ends[i] = addScript(root, &children, input);
+    fclose(input);
+    depths[i] = 1;
+    for(Node *node = ends[i]; node != root; node = node->parent){
+      depths[i]++;
     }
   }
-  return;
+
+  //Capture all output, run the shared start and then every node.
+  frames = tmpfile();
+  messages = tmpfile();
+  if( !frames || !messages ){
+    fprintf(stderr, "Can't create batch output\n");
+    exit (1);
+  }
+  root->outStart = ftell(frames);
+  root->errStart = ftell(messages);
+  if(worldName){
+    startWorld(session, worldName);
+  }
+  root->outEnd = ftell(frames);
+  root->errEnd = ftell(messages);
+  runTrie(session, root);
+
+  //Write out each script's share of the output.
+  for(int i = 0; i < count; i++){
+    FILE *out = openOutput(names[i], ".out");
+    FILE *err = openOutput(names[i], ".err");
+    writeScript(ends[i], depths[i], out, err);
+    fclose(out);
+    fclose(err);
+  }
+
+  fclose(frames);
+  fclose(messages);
+  freeTrie(root->child);
+  free(root);
+  free(children.slots);
+  free(ends);
+  free(depths);
 }
 
 
 /**
-   The main program can run with either 1 or 0 command line arguments. The function determines whether there is a valid
-   number of command line arguments and then chooses whether to process from a file or from standard input.
+   The main program can run with either 1 or 0 script arguments. The function determines whether there is a valid
+   set of command line arguments and then chooses whether to process from a file or from standard input.
+   With --world, the map is checked against (and movement-only commands are filled in from) a known world.
+   With --batch, any number of scripts are run together and each one's output goes to files named after it.
+   With --format=bin, frames are written as binary records (see frame.h) instead of text.
+   With --check, the script is only checked: every invalid line is reported, and nothing is run.
    @param argc - count of command line arguments
    @param *argv[] - array of command line arguments
    @return exit statues - either successful or unsuccessful
  */
 int main( int argc, char *argv[] ){
+  char *worldName = NULL;
+  char **scriptNames = (char **) malloc(argc * sizeof(char *));
+  int scripts = 0;
+  int batch = 0;
+  int check = 0;
   
-  //Check for correct amount of arguments
-  if(argc > 2){
-    fprintf(stderr, "usage: explorer [script_file]\n");
+  //Check for correct arguments
+  for(int i = 1; i < argc; i++){
+    if(!strcmp(argv[i], "--world")){
+      if(i + 1 == argc || worldName){
+        fprintf(stderr, USAGE);
+        exit (1);
+      }
+      worldName = argv[++i];
+    } else if(!strcmp(argv[i], "--batch")){
+      batch = 1;
+    } else if(!strcmp(argv[i], "--check")){
+      check = 1;
+    } else if(!strcmp(argv[i], "--format=bin")){
+      binary = 1;
+    } else if(!strcmp(argv[i], "--format=text")){
+      binary = 0;
+    } else {
+      scriptNames[scripts++] = argv[i];
+    }
+  }
+  if(batch ? check || scripts == 0 : scripts > 1){
+    fprintf(stderr, USAGE);
     exit (1);
   }
   
-  //Attempt to open the input file
-  if(argc == 2){  
-    FILE *input = fopen(argv[1], "r");
-    if( !input ){
-      fprintf(stderr, "Can't open movement script: %s\nusage: explorer [script_file]\n", argv[1]);
-      exit (1);
+  //Frames go to standard output and messages to standard error, unless a batch captures them.
+  frames = stdout;
+  messages = stderr;
+  initFrame(&lastFrame);
+  
+  //Check the script without running it. The world file is not needed for that.
+  if(check){
+    FILE *input = stdin;
+    if(scripts){
+      input = fopen(scriptNames[0], "r");
+      if( !input ){
+        fprintf(stderr, "Can't open movement script: %s\n" USAGE, scriptNames[0]);
+        exit (1);
+      }
+    }
+    //Reports are buffered, since a large script can have a great many of them.
+    setvbuf(messages, NULL, _IOFBF, BUFSIZ);
+    long count = checkInput(input, worldName != NULL);
+    if(input != stdin){
+      fclose(input);
+    }
+    free(scriptNames);
+    exit(count ? 1 : 0);
+  }
+  
+  //Create the session, sending its frames and statistics to the chosen format.
+  ExplorerSinks sinks = { binary ? binaryFrame : textFrame, showStats, NULL };
+  ExplorerSession *session = explorerCreate(&sinks);
+  
+  if(batch){
+    runBatch(session, scriptNames, scripts, worldName);
+  } else {
+    //Attempt to open the input file, before the world prints anything.
+    FILE *input = stdin;
+    if(scripts){  
+      input = fopen(scriptNames[0], "r");
+      if( !input ){
+        fprintf(stderr, "Can't open movement script: %s\n" USAGE, scriptNames[0]);
+        exit (1);
+      }
+    }
+    
+    //Start from the world if there is one.
+    if(worldName){
+      startWorld(session, worldName);
+    }
+    buildFromFile(session, input);
+    if(input != stdin){
+      fclose(input);
     }
-    buildFromFile(input);
-    fclose(input);
-  } else{
-    buildFromStandard();
   }
   
   //Free up remaining allocated memory.
-  freeMap(map, rows);
-  freeMap(savemap, oldrows);
+  explorerFree(session);
+  freeFrame(&lastFrame);
+  free(scriptNames);
   
   //Successful return.
   exit(0);
-}
\ No newline at end of file
+}
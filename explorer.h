@@ -0,0 +1,246 @@
+/**
+   @file explorer.h
+   @author Louis Warner (elwarner)
+   This file contains the public interface of libexplorer.a, the explorer engine as a library.
+   Every session is independent (there is no global state), commands report what happened with a
+   status code instead of printing, and frames are handed to caller-provided sinks. Once a session's
+   grid has grown to the size it needs, running commands does no heap allocation (other
+   than growing the undo log of a marked session).
+   These functions are defined in session.c, except explorerCheck, which is in check.c. Every name
+   the library exports starts with explorer (or Explorer, or EXPLORER_ for constants).
+ */
+#ifndef EXPLORER_H
+#define EXPLORER_H
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Directions the player can face (as on a keypad, and as in the binary frame format).
+#define EXPLORER_NORTH 8
+#define EXPLORER_SOUTH 2
+#define EXPLORER_EAST 6
+#define EXPLORER_WEST 4
+
+//Longest script line that can hold a valid command.
+#define EXPLORER_LINE_LIMIT 32
+
+//Status codes returned by commands.
+#define EXPLORER_OK 0
+#define EXPLORER_BLOCKED 1
+#define EXPLORER_INVALID 2
+#define EXPLORER_INCONSISTENT 3
+#define EXPLORER_QUIT 4
+
+/**
+   A frame as handed to a frame sink. Row i of the map is the cols characters starting at
+   grid + i * stride (not null terminated), with the player's arrow already drawn in.
+   dir is one of EXPLORER_NORTH, EXPLORER_SOUTH, EXPLORER_EAST or EXPLORER_WEST.
+   The rest says how the frame differs from the previous one this session showed, so a sink need
+   not compare whole maps: the map grew by addedRows rows and addedCols columns, shiftRows and
+   shiftCols of them at the top and left (which moved every old cell down and right by that much),
+   and then the changes cells listed in changed as (row, col) pairs, in row-major order, took new
+   values. Cells in the added rows and columns that are not listed are unknown (' '). changes is -1
+   for the first frame, when there is nothing to compare with.
+   The view is only valid during the call.
+ */
+typedef struct {
+  const char *grid;
+  int stride;
+  int rows;
+  int cols;
+  int row;
+  int col;
+  int dir;
+  int addedRows;
+  int addedCols;
+  int shiftRows;
+  int shiftCols;
+  int changes;
+  const int *changed;
+} ExplorerView;
+
+/**
+   Running statistics about the known part of a map: how many cells are known, how many of them are
+   walls and items (by letter), and the bounding box of known cells in map coordinates (-1 when nothing
+   is known yet).
+ */
+typedef struct {
+  int area;
+  int walls;
+  int items[26];
+  int minRow;
+  int minCol;
+  int maxRow;
+  int maxCol;
+} ExplorerStats;
+
+/**
+   Callbacks a session uses for output. Either may be NULL. frame is called after every command
+   that changes what the player sees, and stats is called by the stats script command.
+ */
+typedef struct {
+  void (*frame)( void *context, const ExplorerView *view );
+  void (*stats)( void *context, const ExplorerStats *stats );
+  void *context;
+} ExplorerSinks;
+
+/**
+   An explorer session: one map and one player. Its contents are private to session.c.
+ */
+typedef struct ExplorerSession ExplorerSession;
+
+
+/**
+   This function creates a new session, with nothing known and the player facing north.
+   @param ExplorerSinks *sinks - where output goes (copied), or NULL for none
+   @return ExplorerSession *session - the new session
+ */
+ExplorerSession *explorerCreate( ExplorerSinks *sinks );
+
+
+/**
+   This function frees a session and everything it holds.
+   @param ExplorerSession *session - the session to free
+ */
+void explorerFree( ExplorerSession *session );
+
+
+/**
+   This function creates a new session that is an exact copy of another, sinks included.
+   @param ExplorerSession *session - the session to copy
+   @return ExplorerSession *copy - the new session
+ */
+ExplorerSession *explorerClone( ExplorerSession *session );
+
+
+/**
+   This function makes one session an exact copy of another, reusing its memory where it can.
+   Both sessions must have the same world (or no world). The copy has no marks.
+   @param ExplorerSession *to - the session to overwrite
+   @param ExplorerSession *from - the session to copy
+ */
+void explorerCopy( ExplorerSession *to, ExplorerSession *from );
+
+
+/**
+   This function marks the current state of a session, so that explorerUndo can put it back.
+   Marks nest, and while a session has any, every command also records what it overwrites.
+   explorerLoadWorld is not undone, so a world should be loaded before the first mark.
+   @param ExplorerSession *session - the session
+ */
+void explorerMark( ExplorerSession *session );
+
+
+/**
+   This function puts a session back to the state of its most recent mark, which is kept, so it
+   can be gone back to again. The time it takes is proportional to what changed since the mark.
+   @param ExplorerSession *session - the session, which must have a mark
+ */
+void explorerUndo( ExplorerSession *session );
+
+
+/**
+   This function forgets the most recent mark of a session, without changing the session.
+   @param ExplorerSession *session - the session, which must have a mark
+ */
+void explorerDrop( ExplorerSession *session );
+
+
+/**
+   This function switches a session to world mode: the world is read from the file, the map is
+   started from the player's view in it, and from then on sight sequences may be left out and
+   are checked against the world when given. It must be called before any other command.
+   @param ExplorerSession *session - the session
+   @param FILE *fp - the world file (see loadWorld in world.h)
+   @return int status - EXPLORER_OK, or EXPLORER_INVALID if the file is not a valid world
+ */
+int explorerLoadWorld( ExplorerSession *session, FILE *fp );
+
+
+/**
+   This function starts the map from the initial sight sequence.
+   @param ExplorerSession *session - the session
+   @param const char *sight - the 3 characters the player sees at the start
+   @return int status - EXPLORER_OK, or EXPLORER_INVALID if the sequence is not valid or the map has already started
+ */
+int explorerStart( ExplorerSession *session, const char *sight );
+
+
+/**
+   This function moves the player forward one cell.
+   @param ExplorerSession *session - the session
+   @param const char *sight - the 3 characters seen after the move, or NULL in world mode
+   @return int status - EXPLORER_OK, EXPLORER_BLOCKED, EXPLORER_INVALID or EXPLORER_INCONSISTENT
+ */
+int explorerForward( ExplorerSession *session, const char *sight );
+
+
+/**
+   This function turns the player left.
+   @param ExplorerSession *session - the session
+   @param const char *sight - the 3 characters seen after the turn, or NULL in world mode
+   @return int status - EXPLORER_OK, EXPLORER_INVALID or EXPLORER_INCONSISTENT
+ */
+int explorerLeft( ExplorerSession *session, const char *sight );
+
+
+/**
+   This function turns the player right.
+   @param ExplorerSession *session - the session
+   @param const char *sight - the 3 characters seen after the turn, or NULL in world mode
+   @return int status - EXPLORER_OK, EXPLORER_INVALID or EXPLORER_INCONSISTENT
+ */
+int explorerRight( ExplorerSession *session, const char *sight );
+
+
+/**
+   This function explores the world on its own (world mode only): it repeatedly follows a route to the
+   nearest known passable cell next to an unknown one and turns to reveal it, until nothing reachable
+   is unknown or the step budget runs out.
+   @param ExplorerSession *session - the session
+   @param int budget - most moves and turns to take, or -1 for no limit
+   @return int status - EXPLORER_OK, or EXPLORER_INVALID outside world mode
+ */
+int explorerExplore( ExplorerSession *session, int budget );
+
+
+/**
+   This function runs one line of a movement script ("forward ...", "left", "explore 20", "stats", ...).
+   The line is not changed.
+   @param ExplorerSession *session - the session
+   @param const char *line - the line, without its newline
+   @return int status - the status of the command, or EXPLORER_QUIT for "quit"
+ */
+int explorerLine( ExplorerSession *session, const char *line );
+
+
+/**
+   This function gets the running map statistics for a session.
+   @param ExplorerSession *session - the session
+   @param ExplorerStats *stats - filled with the statistics
+ */
+void explorerStats( ExplorerSession *session, ExplorerStats *stats );
+
+
+/**
+   This function finds every line of a movement script that the explorer would reject with
+   "Invalid command", without running it. Since that only depends on how the lines are written,
+   this is exactly the set of lines a run would reject (a run may also report "Blocked" or
+   "Inconsistent map", which depend on the map). Lines after a quit command are never run, so they
+   are not checked.
+   @param const char *text - the script, which need not be null terminated
+   @param long size - number of characters in the script
+   @param int world - 1 if the script is for world mode, otherwise 0
+   @param void (*report)( void *context, long line ) - called with the number (counting from 1) of each invalid line, in order, or NULL
+   @param void *context - passed to report
+   @return long count - number of invalid lines
+ */
+long explorerCheck( const char *text, long size, int world, void (*report)( void *context, long line ), void *context );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,417 @@
+/**
+   @file frame.c
+   @author Louis Warner (elwarner)
+   This file contains the writer and reader for the binary frame format used by explorer --format=bin.
+   Machine consumers can read the player and map state straight from the records instead of parsing
+   the bordered text frames, and frames after the first carry only the cells that changed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "map.h"
+#include "frame.h"
+
+//Size of a frame record header: type, rows, cols, player row, player col and dir.
+#define HEADER_SIZE 18
+
+//Size of a statistics record: type, area, walls, 26 item counts and the bounding box.
+#define STATS_SIZE 129
+
+//Longest run in a full frame.
+#define RUN_LIMIT 255
+
+//Largest record the reader accepts: a change list covering every cell of the largest frame.
+#define RECORD_LIMIT ( HEADER_SIZE + 4 + 9 * (size_t) FRAME_CELL_LIMIT )
+
+/**
+   Grows a block of memory to hold at least the given number of bytes, leaving it as it was if
+   there is not enough memory.
+   @param void **block - the block, updated if it moves
+   @param size_t *capacity - the size of the block, updated if it grows
+   @param size_t size - number of bytes needed
+   @return int ok - 1 if the block is large enough, 0 if there was not enough memory
+ */
+static int reserve( void **block, size_t *capacity, size_t size ){
+  if( size <= *capacity ){
+    return 1;
+  }
+  size_t grown = size <= (size_t) -1 / 2 ? size * 2 : size;
+  void *moved = realloc( *block, grown );
+  if( !moved ){
+    return 0;
+  }
+  *block = moved;
+  *capacity = grown;
+  return 1;
+}
+
+/**
+   Makes sure a frame's record buffer can hold the given number of bytes.
+   @param Frame *frame - the frame that owns the buffer
+   @param size_t size - number of bytes needed
+   @return int ok - 1 if it can, 0 if there was not enough memory
+ */
+static int reserveBuffer( Frame *frame, size_t size ){
+  void *block = frame->buffer;
+  int ok = reserve( &block, &frame->bufferCapacity, size );
+  frame->buffer = (unsigned char *) block;
+  return ok;
+}
+
+/**
+   Makes sure a frame's grid can hold the given number of cells.
+   @param Frame *frame - the frame that owns the grid
+   @param size_t size - number of cells needed
+   @return int ok - 1 if it can, 0 if there was not enough memory
+ */
+static int reserveGrid( Frame *frame, size_t size ){
+  void *block = frame->grid;
+  int ok = reserve( &block, &frame->capacity, size );
+  frame->grid = (char *) block;
+  return ok;
+}
+
+/**
+   Stores a 4-byte little-endian number.
+   @param unsigned char *at - where to store it
+   @param unsigned long n - the number
+ */
+static void putNumber( unsigned char *at, unsigned long n ){
+  for( int i = 0; i < 4; i++ ){
+    at[i] = ( n >> ( 8 * i ) ) & 0xFF;
+  }
+}
+
+/**
+   Loads a 4-byte little-endian number.
+   @param unsigned char *at - where it is stored
+   @return unsigned long n - the number
+ */
+static unsigned long getNumber( unsigned char *at ){
+  unsigned long n = 0;
+  for( int i = 3; i >= 0; i-- ){
+    n = ( n << 8 ) | at[i];
+  }
+  return n;
+}
+
+/**
+   Loads a 4-byte little-endian number that may be negative.
+   @param unsigned char *at - where it is stored
+   @return int n - the number
+ */
+static int getSigned( unsigned char *at ){
+  unsigned long n = getNumber( at );
+  return n >= 0x80000000UL ? -(int) ( 0xFFFFFFFFUL - n ) - 1 : (int) n;
+}
+
+/**
+   This function sets up an empty frame, before the first frame of a stream.
+   @param Frame *frame - the frame to set up
+ */
+void initFrame( Frame *frame ){
+  frame->rows = 0;
+  frame->cols = 0;
+  frame->row = 0;
+  frame->col = 0;
+  frame->dir = NORTH;
+  frame->grid = NULL;
+  frame->capacity = 0;
+  frame->buffer = NULL;
+  frame->bufferCapacity = 0;
+}
+
+/**
+   This function frees the memory held by a frame.
+   @param Frame *frame - the frame to free
+ */
+void freeFrame( Frame *frame ){
+  free( frame->grid );
+  free( frame->buffer );
+  initFrame( frame );
+}
+
+/**
+   Appends a list of changed cells to the record being built: their number, then (row, col, character)
+   for each, with the characters taken from the view.
+   @param Frame *frame - holds the record buffer
+   @param size_t size - bytes of the record already built
+   @param const ExplorerView *view - the frame and its changes
+   @return size_t size - bytes of the record built so far, or 0 if there was not enough memory
+ */
+static size_t putChanges( Frame *frame, size_t size, const ExplorerView *view ){
+  if( !reserveBuffer( frame, size + 4 + 9 * (size_t) view->changes ) ){
+    return 0;
+  }
+  putNumber( frame->buffer + size, view->changes );
+  size += 4;
+  for( int i = 0; i < view->changes; i++ ){
+    int r = view->changed[2 * i];
+    int c = view->changed[2 * i + 1];
+    putNumber( frame->buffer + size, r );
+    putNumber( frame->buffer + size + 4, c );
+    frame->buffer[size + 8] = view->grid[(size_t) r * view->stride + c];
+    size += 9;
+  }
+  return size;
+}
+
+/**
+   This function writes a frame from a session as a binary record: a full frame for the first frame,
+   and otherwise the change list the session gives, after a resize if the map grew.
+   @param FILE *fp - the stream to write to
+   @param Frame *frame - holds the record buffer
+   @param const ExplorerView *view - the frame, as handed to a frame sink
+   @return int status - 0, FRAME_TOO_LARGE if the map has more than FRAME_CELL_LIMIT cells, or
+                        FRAME_NO_MEMORY if there was not enough memory (nothing is written either way)
+ */
+int writeFrame( FILE *fp, Frame *frame, const ExplorerView *view ){
+  size_t size = HEADER_SIZE;
+  unsigned char *record;
+
+  if( (size_t) view->rows * view->cols > FRAME_CELL_LIMIT ){
+    return FRAME_TOO_LARGE;
+  }
+  if( !reserveBuffer( frame, HEADER_SIZE ) ){
+    return FRAME_NO_MEMORY;
+  }
+  if( view->changes >= 0 && ( view->addedRows || view->addedCols ) ){
+    //The map grew, so say where the old map went, then list the cells that changed.
+    if( !reserveBuffer( frame, HEADER_SIZE + 8 ) ){
+      return FRAME_NO_MEMORY;
+    }
+    putNumber( frame->buffer + HEADER_SIZE, view->shiftRows );
+    putNumber( frame->buffer + HEADER_SIZE + 4, view->shiftCols );
+    size = putChanges( frame, size + 8, view );
+    frame->buffer[0] = FRAME_RESIZE;
+  } else if( view->changes >= 0 ){
+    //Same size as before, so list only the cells that changed.
+    size = putChanges( frame, size, view );
+    frame->buffer[0] = FRAME_DELTA;
+  } else {
+    //First frame, so send the whole grid as runs of the same character, which may cross rows.
+    int i = 0;
+    int j = 0;
+    while( i < view->rows ){
+      char ch = view->grid[(size_t) i * view->stride + j];
+      int run = 0;
+      while( run < RUN_LIMIT && i < view->rows && view->grid[(size_t) i * view->stride + j] == ch ){
+        run++;
+        if( ++j == view->cols ){
+          i++;
+          j = 0;
+        }
+      }
+      if( !reserveBuffer( frame, size + 2 ) ){
+        return FRAME_NO_MEMORY;
+      }
+      frame->buffer[size] = run;
+      frame->buffer[size + 1] = ch;
+      size += 2;
+    }
+    frame->buffer[0] = FRAME_FULL;
+  }
+  if( size == 0 ){
+    return FRAME_NO_MEMORY;
+  }
+
+  //Fill in the header and write the record after its length.
+  record = frame->buffer;
+  putNumber( record + 1, view->rows );
+  putNumber( record + 5, view->cols );
+  putNumber( record + 9, view->row );
+  putNumber( record + 13, view->col );
+  record[17] = view->dir;
+
+  unsigned char length[4];
+  putNumber( length, size );
+  fwrite( length, 1, 4, fp );
+  fwrite( record, 1, size, fp );
+  return 0;
+}
+
+/**
+   This function reads the next record from a binary stream. A frame record is applied to the frame
+   and a statistics record is stored in stats. Records of types it does not know are skipped.
+   @param FILE *fp - the stream to read from
+   @param Frame *frame - the previous frame, updated to the new one
+   @param MapStats *stats - filled in by a statistics record
+   @return int type - the record type read, 0 at the end of the stream or -1 if the stream is malformed
+ */
+int readRecord( FILE *fp, Frame *frame, MapStats *stats ){
+  unsigned char length[4];
+  unsigned long size;
+  unsigned char *record;
+
+  while( 1 ){
+    //Read the length, then the whole record.
+    size_t got = fread( length, 1, 4, fp );
+    if( got == 0 ){
+      return 0;
+    }
+    if( got < 4 ){
+      return -1;
+    }
+    size = getNumber( length );
+    if( size == 0 || size > RECORD_LIMIT || !reserveBuffer( frame, size ) ){
+      return -1;
+    }
+    record = frame->buffer;
+    if( fread( record, 1, size, fp ) != size ){
+      return -1;
+    }
+    if( record[0] == FRAME_FULL || record[0] == FRAME_DELTA || record[0] == FRAME_RESIZE || record[0] == FRAME_STATS ){
+      break;
+    }
+  }
+
+  if( record[0] == FRAME_STATS ){
+    if( size != STATS_SIZE ){
+      return -1;
+    }
+    stats->area = getNumber( record + 1 );
+    stats->walls = getNumber( record + 5 );
+    for( int i = 0; i < 26; i++ ){
+      stats->items[i] = getNumber( record + 9 + 4 * i );
+    }
+    stats->minRow = getSigned( record + 113 );
+    stats->minCol = getSigned( record + 117 );
+    stats->maxRow = getSigned( record + 121 );
+    stats->maxCol = getSigned( record + 125 );
+    return FRAME_STATS;
+  }
+  if( size < HEADER_SIZE ){
+    return -1;
+  }
+
+  unsigned long rows = getNumber( record + 1 );
+  unsigned long cols = getNumber( record + 5 );
+  unsigned long row = getNumber( record + 9 );
+  unsigned long col = getNumber( record + 13 );
+  if( rows == 0 || cols == 0 || cols > FRAME_CELL_LIMIT / rows || row >= rows || col >= cols ){
+    return -1;
+  }
+
+  //Where the change list starts, in the records that have one.
+  unsigned long listAt = HEADER_SIZE;
+
+  if( record[0] == FRAME_FULL ){
+    //Expand the runs into the grid, after checking the record has enough of them to cover it.
+    unsigned long cell = 0;
+    if( rows * cols > ( size - HEADER_SIZE ) / 2 * RUN_LIMIT || !reserveGrid( frame, rows * cols ) ){
+      return -1;
+    }
+    for( unsigned long at = HEADER_SIZE; at + 1 < size; at += 2 ){
+      if( record[at] == 0 || cell + record[at] > rows * cols ){
+        return -1;
+      }
+      memset( frame->grid + cell, record[at + 1], record[at] );
+      cell += record[at];
+    }
+    if( cell != rows * cols ){
+      return -1;
+    }
+  } else if( record[0] == FRAME_RESIZE ){
+    //Move the previous grid to its place in the larger one, working up from the bottom row so
+    //nothing is overwritten before it has moved, and clear everything around it.
+    unsigned long oldRows = frame->rows;
+    unsigned long oldCols = frame->cols;
+    if( oldRows == 0 || size < HEADER_SIZE + 8 ){
+      return -1;
+    }
+    unsigned long shiftRows = getNumber( record + HEADER_SIZE );
+    unsigned long shiftCols = getNumber( record + HEADER_SIZE + 4 );
+    if( rows < oldRows || cols < oldCols || shiftRows > rows - oldRows || shiftCols > cols - oldCols ||
+        !reserveGrid( frame, rows * cols ) ){
+      return -1;
+    }
+    for( unsigned long i = oldRows; i-- > 0; ){
+      char *to = frame->grid + ( i + shiftRows ) * cols;
+      memmove( to + shiftCols, frame->grid + i * oldCols, oldCols );
+      memset( to, ' ', shiftCols );
+      memset( to + shiftCols + oldCols, ' ', cols - shiftCols - oldCols );
+    }
+    memset( frame->grid, ' ', shiftRows * cols );
+    memset( frame->grid + ( shiftRows + oldRows ) * cols, ' ', ( rows - shiftRows - oldRows ) * cols );
+    frame->rows = rows;
+    frame->cols = cols;
+    listAt += 8;
+  }
+  if( record[0] != FRAME_FULL ){
+    //Apply each changed cell to the previous grid.
+    if( rows != frame->rows || cols != frame->cols || size < listAt + 4 ){
+      return -1;
+    }
+    unsigned long count = getNumber( record + listAt );
+    if( count > ( size - listAt - 4 ) / 9 ){
+      return -1;
+    }
+    for( unsigned long i = 0; i < count; i++ ){
+      unsigned char *cell = record + listAt + 4 + 9 * i;
+      unsigned long r = getNumber( cell );
+      unsigned long c = getNumber( cell + 4 );
+      if( r >= rows || c >= cols ){
+        return -1;
+      }
+      frame->grid[r * cols + c] = cell[8];
+    }
+  }
+
+  frame->rows = rows;
+  frame->cols = cols;
+  frame->row = row;
+  frame->col = col;
+  frame->dir = record[17];
+  return record[0];
+}
+
+
+/**
+   This function reads the next frame from a binary stream and applies it to the frame.
+   Records that are not frames are skipped.
+   @param FILE *fp - the stream to read from
+   @param Frame *frame - the previous frame, updated to the new one
+   @return int status - 1 if a frame was read, 0 at the end of the stream or -1 if the stream is malformed
+ */
+int readFrame( FILE *fp, Frame *frame ){
+  MapStats stats;
+  int type;
+  do {
+    type = readRecord( fp, frame, &stats );
+  } while( type == FRAME_STATS );
+  return type > 0 ? 1 : type;
+}
+
+
+/**
+   This function writes map statistics as a binary record.
+   @param FILE *fp - the stream to write to
+   @param MapStats *stats - the statistics to write
+ */
+void writeStats( FILE *fp, MapStats *stats ){
+  unsigned char record[4 + STATS_SIZE];
+  putNumber( record, STATS_SIZE );
+  record[4] = FRAME_STATS;
+  putNumber( record + 5, stats->area );
+  putNumber( record + 9, stats->walls );
+  for( int i = 0; i < 26; i++ ){
+    putNumber( record + 13 + 4 * i, stats->items[i] );
+  }
+  putNumber( record + 117, (unsigned long) stats->minRow );
+  putNumber( record + 121, (unsigned long) stats->minCol );
+  putNumber( record + 125, (unsigned long) stats->maxRow );
+  putNumber( record + 129, (unsigned long) stats->maxCol );
+  fwrite( record, 1, sizeof( record ), fp );
+}
+
+
+
+
+/**
+   This function prints a frame in the same text form as showMap.
+   @param FILE *fp - the stream to print to
+   @param Frame *frame - the frame to print
+ */
+void printFrame( FILE *fp, Frame *frame ){
+  printGrid( fp, frame->grid, frame->cols, frame->rows, frame->cols );
+}
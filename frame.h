@@ -0,0 +1,122 @@
+/**
+   @file frame.h
+   @author Louis Warner (elwarner)
+   This file contains declarations for the binary frame format written by explorer --format=bin,
+   and for the small library that writes and reads it. These functions are defined in frame.c.
+
+   The stream is a sequence of records. Every record starts with a 4-byte length (of everything
+   after it), followed by a 1-byte record type. All numbers are unsigned, little-endian, 4 bytes.
+   The 1-byte dir is the player's direction: 8 north, 2 south, 6 east, 4 west (as on a keypad).
+     FRAME_FULL:  rows, cols, player row, player col, 1-byte dir, then the grid in row-major order
+                  as run-length pairs (1-byte count from 1 to 255, 1-byte character).
+     FRAME_DELTA: rows, cols, player row, player col, 1-byte dir, number of changed cells, then
+                  (row, col, 1-byte character) for each cell that differs from the previous frame.
+                  The size is always the same as the previous frame's.
+     FRAME_RESIZE: rows, cols, player row, player col, 1-byte dir, shift rows, shift cols, then a
+                  change list as in FRAME_DELTA. The map has grown: the previous frame moves down by
+                  shift rows and right by shift cols inside the new, larger size, every cell outside
+                  it is ' ', and then the changed cells are applied.
+     FRAME_STATS: area, walls, 26 item counts (a to z), then the bounding box as top, left,
+                  bottom, right (-1 as 0xFFFFFFFF when nothing is known), written by the stats command.
+   The grid holds exactly what the text frame shows between its borders, player arrow included.
+   Only the first frame of a stream needs to be a FRAME_FULL, so a frame costs about the same however large
+   the map is. Writers refuse, and readers reject, frames of more than FRAME_CELL_LIMIT cells; there
+   is no other limit on rows or cols.
+ */
+#ifndef FRAME_H
+#define FRAME_H
+#include <stdio.h>
+#include <stddef.h>
+#include "map.h"
+
+#define FRAME_FULL 'F'
+#define FRAME_DELTA 'D'
+#define FRAME_RESIZE 'R'
+#define FRAME_STATS 'S'
+
+//Most cells a frame can have (as many as 8192 by 8192).
+#define FRAME_CELL_LIMIT ( 1UL << 26 )
+
+//Reasons writeFrame can fail.
+#define FRAME_TOO_LARGE -1
+#define FRAME_NO_MEMORY -2
+
+/**
+   One decoded frame. The writer only uses its record buffer.
+ */
+typedef struct {
+  int rows;
+  int cols;
+  int row;
+  int col;
+  int dir;
+  char *grid;
+  size_t capacity;
+  unsigned char *buffer;
+  size_t bufferCapacity;
+} Frame;
+
+
+/**
+   This function sets up an empty frame, before the first frame of a stream.
+   @param Frame *frame - the frame to set up
+ */
+void initFrame( Frame *frame );
+
+
+/**
+   This function frees the memory held by a frame.
+   @param Frame *frame - the frame to free
+ */
+void freeFrame( Frame *frame );
+
+
+/**
+   This function writes a frame from a session as a binary record: a full frame for the first frame,
+   and otherwise the change list the session gives, after a resize if the map grew.
+   @param FILE *fp - the stream to write to
+   @param Frame *frame - holds the record buffer
+   @param const ExplorerView *view - the frame, as handed to a frame sink
+   @return int status - 0, FRAME_TOO_LARGE if the map has more than FRAME_CELL_LIMIT cells, or
+                        FRAME_NO_MEMORY if there was not enough memory (nothing is written either way)
+ */
+int writeFrame( FILE *fp, Frame *frame, const ExplorerView *view );
+
+
+/**
+   This function reads the next record from a binary stream. A frame record is applied to the frame
+   and a statistics record is stored in stats. Records of types it does not know are skipped.
+   @param FILE *fp - the stream to read from
+   @param Frame *frame - the previous frame, updated to the new one
+   @param MapStats *stats - filled in by a statistics record
+   @return int type - the record type read, 0 at the end of the stream or -1 if the stream is malformed
+ */
+int readRecord( FILE *fp, Frame *frame, MapStats *stats );
+
+
+/**
+   This function reads the next frame from a binary stream and applies it to the frame.
+   Records that are not frames are skipped.
+   @param FILE *fp - the stream to read from
+   @param Frame *frame - the previous frame, updated to the new one
+   @return int status - 1 if a frame was read, 0 at the end of the stream or -1 if the stream is malformed
+ */
+int readFrame( FILE *fp, Frame *frame );
+
+
+/**
+   This function prints a frame in the same text form as showMap.
+   @param FILE *fp - the stream to print to
+   @param Frame *frame - the frame to print
+ */
+void printFrame( FILE *fp, Frame *frame );
+
+
+/**
+   This function writes map statistics as a binary record.
+   @param FILE *fp - the stream to write to
+   @param MapStats *stats - the statistics to write
+ */
+void writeStats( FILE *fp, MapStats *stats );
+
+#endif
@@ -0,0 +1,58 @@
+/**
+   @file frametext.c
+   @author Louis Warner (elwarner)
+   This program converts the binary output of explorer --format=bin back into the text frames
+   explorer prints by default (frames and statistics lines), so the two formats can be compared.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "frame.h"
+
+/**
+   The main program reads binary frames from the file named on the command line (or standard input)
+   and prints each one as a text frame.
+   @param argc - count of command line arguments
+   @param *argv[] - array of command line arguments
+   @return exit statues - either successful or unsuccessful
+ */
+int main( int argc, char *argv[] ){
+  FILE *input = stdin;
+  Frame frame;
+  MapStats stats;
+  int status;
+
+  //Check for correct amount of arguments
+  if( argc > 2 ){
+    fprintf( stderr, "usage: frametext [frame_file]\n" );
+    exit( 1 );
+  }
+
+  //Attempt to open the input file
+  if( argc == 2 ){
+    input = fopen( argv[1], "rb" );
+    if( !input ){
+      fprintf( stderr, "Can't open frame file: %s\nusage: frametext [frame_file]\n", argv[1] );
+      exit( 1 );
+    }
+  }
+
+  //Print every frame and statistics line in the stream.
+  initFrame( &frame );
+  while( ( status = readRecord( input, &frame, &stats ) ) > 0 ){
+    if( status == FRAME_STATS ){
+      printStats( stdout, &stats );
+    } else {
+      printFrame( stdout, &frame );
+    }
+  }
+  freeFrame( &frame );
+  if( input != stdin ){
+    fclose( input );
+  }
+
+  if( status < 0 ){
+    fprintf( stderr, "Malformed frame stream\n" );
+    exit( 1 );
+  }
+  exit( 0 );
+}
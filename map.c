@@ -9,11 +9,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#define INITIAL_MAP_SIZE 3
-#define NORTH 8
-#define SOUTH 2
-#define EAST 6
-#define WEST 4
+#include "map.h"
 
 
 /**
@@ -61,6 +57,20 @@ void freeMap( char **map, int rows ){
    @param int dir - direction for the user (NORTH, SOUTH, EAST, or WEST)
  */
 void showMap( char **map, int rows, int rowPos, int colPos, int dir ){
+  printMap(stdout, map, rows, rowPos, colPos, dir);
+}
+
+
+/**
+   This function will print the given map (of the given height in rows) to the given stream.
+   @param FILE *fp - the stream to print to
+   @param char **map - the map to be printed
+   @param int rows - height of the map
+   @param int rowPos - y-coordinate for the user
+   @param int colPos - x-coordinate for the user
+   @param int dir - direction for the user (NORTH, SOUTH, EAST, or WEST)
+ */
+void printMap( FILE *fp, char **map, int rows, int rowPos, int colPos, int dir ){
   //Set directional arrow.
   if(dir == NORTH){
     map[rowPos][colPos] = '^';
@@ -76,23 +86,55 @@ void showMap( char **map, int rows, int rowPos, int colPos, int dir ){
   }
   
   //Print top border.
-  fprintf(stdout, "+");
+  fprintf(fp, "+");
   for(int i = 0; i < strlen(map[0]); i++){
-    fprintf(stdout, "-");
+    fprintf(fp, "-");
   }
-  fprintf(stdout, "+\n");
+  fprintf(fp, "+\n");
   
   //Print all rows and left and right borders.
   for(int j = 0; j < rows; j++){
-    fprintf(stdout, "|%s|\n", map[j]);
+    fprintf(fp, "|%s|\n", map[j]);
   }
   
   //Print bottom border.
-  fprintf(stdout, "+");
+  fprintf(fp, "+");
   for(int k = 0; k < strlen(map[0]); k++){
-    fprintf(stdout, "-");
+    fprintf(fp, "-");
   }
-  fprintf(stdout, "+\n");
+  fprintf(fp, "+\n");
+}
+
+
+/**
+   This function will print a map stored as rows of characters (not strings) in the same form as showMap.
+   @param FILE *fp - the stream to print to
+   @param const char *grid - the map, with the player's arrow drawn in
+   @param int stride - distance from the start of one row to the next in grid
+   @param int rows - height of the map
+   @param int cols - width of the map
+ */
+void printGrid( FILE *fp, const char *grid, int stride, int rows, int cols ){
+  //Print top border.
+  putc('+', fp);
+  for(int i = 0; i < cols; i++){
+    putc('-', fp);
+  }
+  fputs("+\n", fp);
+  
+  //Print all rows and left and right borders.
+  for(int j = 0; j < rows; j++){
+    putc('|', fp);
+    fwrite(grid + j * stride, 1, cols, fp);
+    fputs("|\n", fp);
+  }
+  
+  //Print bottom border.
+  putc('+', fp);
+  for(int k = 0; k < cols; k++){
+    putc('-', fp);
+  }
+  fputs("+\n", fp);
 }
 
 
@@ -193,4 +235,90 @@ char **copyMap( char **map, char **savemap, int rows, int oldrows) {
   
   //Return the new map.
   return newmap;
-}
\ No newline at end of file
+}
+
+
+/**
+   This function clears map statistics, for a map where nothing is known yet.
+   @param MapStats *stats - the statistics to clear
+*/
+void initStats( MapStats *stats ){
+  memset( stats, 0, sizeof( MapStats ) );
+  stats->minRow = stats->minCol = stats->maxRow = stats->maxCol = -1;
+}
+
+
+/**
+   This function counts a cell that has just become known.
+   @param MapStats *stats - the statistics to update
+   @param int row - row of the cell
+   @param int col - column of the cell
+   @param char ch - what the cell holds
+*/
+void addCell( MapStats *stats, int row, int col, char ch ){
+  //Count the cell by what it holds.
+  stats->area++;
+  if(ch == '#'){
+    stats->walls++;
+  } else if(ch >= 'a' && ch <= 'z'){
+    stats->items[ch - 'a']++;
+  }
+  
+  //Grow the bounding box to take it in.
+  if(stats->area == 1){
+    stats->minRow = stats->maxRow = row;
+    stats->minCol = stats->maxCol = col;
+  } else {
+    if(row < stats->minRow){
+      stats->minRow = row;
+    }
+    if(row > stats->maxRow){
+      stats->maxRow = row;
+    }
+    if(col < stats->minCol){
+      stats->minCol = col;
+    }
+    if(col > stats->maxCol){
+      stats->maxCol = col;
+    }
+  }
+}
+
+
+/**
+   This function moves the bounding box after expandMap has shifted the map down or right.
+   @param MapStats *stats - the statistics to update
+   @param int shiftRows - amount the rows were shifted downward
+   @param int shiftCols - amount the columns were shifted rightward
+*/
+void shiftStats( MapStats *stats, int shiftRows, int shiftCols ){
+  if(stats->area > 0){
+    stats->minRow += shiftRows;
+    stats->maxRow += shiftRows;
+    stats->minCol += shiftCols;
+    stats->maxCol += shiftCols;
+  }
+}
+
+
+/**
+   This function prints map statistics as one line, in the form
+   "area=N walls=N items=a:N,b:N box=top,left,bottom,right" (box=- when nothing is known).
+   @param FILE *fp - the stream to print to
+   @param MapStats *stats - the statistics to print
+*/
+void printStats( FILE *fp, MapStats *stats ){
+  int first = 1;
+  fprintf(fp, "area=%d walls=%d items=", stats->area, stats->walls);
+  for(int i = 0; i < 26; i++){
+    if(stats->items[i]){
+      fprintf(fp, "%s%c:%d", first ? "" : ",", 'a' + i, stats->items[i]);
+      first = 0;
+    }
+  }
+  if(stats->area){
+    fprintf(fp, " box=%d,%d,%d,%d\n", stats->minRow, stats->minCol, stats->maxRow, stats->maxCol);
+  } else {
+    fprintf(fp, " box=-\n");
+  }
+}
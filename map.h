@@ -4,11 +4,22 @@
    This file contains helper declarations of helper functions for the explorer.c program. 
    These functions are defined in map.c.
  */
+#ifndef MAP_H
+#define MAP_H
+#include <stdio.h>
+#include "explorer.h"
 #define INITIAL_MAP_SIZE 3
-#define NORTH 8
-#define SOUTH 2
-#define EAST 6
-#define WEST 4
+#define NORTH EXPLORER_NORTH
+#define SOUTH EXPLORER_SOUTH
+#define EAST EXPLORER_EAST
+#define WEST EXPLORER_WEST
+
+/**
+   Running statistics about the known part of a map (see ExplorerStats in explorer.h). Known cells
+   are never forgotten, so these only change when a cell is first seen and when the map grows at
+   the top or left.
+ */
+typedef ExplorerStats MapStats;
 
 /**
    This function allocates memory for the initial map which is in the form of a 3x3 array of characters.
@@ -38,6 +49,29 @@ void freeMap( char **map, int rows );
 void showMap( char **map, int rows, int rowPos, int colPos, int dir );
 
 
+/**
+   This function will print the given map (of the given height in rows) to the given stream.
+   @param FILE *fp - the stream to print to
+   @param char **map - the map to be printed
+   @param int rows - height of the map
+   @param int rowPos - y-coordinate for the user
+   @param int colPos - x-coordinate for the user
+   @param int dir - direction for the user (NORTH, SOUTH, EAST, or WEST)
+ */
+void printMap( FILE *fp, char **map, int rows, int rowPos, int colPos, int dir );
+
+
+/**
+   This function will print a map stored as rows of characters (not strings) in the same form as showMap.
+   @param FILE *fp - the stream to print to
+   @param const char *grid - the map, with the player's arrow drawn in
+   @param int stride - distance from the start of one row to the next in grid
+   @param int rows - height of the map
+   @param int cols - width of the map
+ */
+void printGrid( FILE *fp, const char *grid, int stride, int rows, int cols );
+
+
 /**
    This function will return an expanded version of the map, expanding either the rows or columns of
    the map based on parameter criteria. 
@@ -61,4 +95,41 @@ char **expandMap( char **map, int *rows, int extraRows, int extraCols, int shift
    @param int oldrows - height of savemap
    @return char **newmap - saved map state (will be sent to savemap in the function call)
 */
-char **copyMap( char **map, char **savemap, int rows, int oldrows);
\ No newline at end of file
+char **copyMap( char **map, char **savemap, int rows, int oldrows);
+
+
+/**
+   This function clears map statistics, for a map where nothing is known yet.
+   @param MapStats *stats - the statistics to clear
+*/
+void initStats( MapStats *stats );
+
+
+/**
+   This function counts a cell that has just become known.
+   @param MapStats *stats - the statistics to update
+   @param int row - row of the cell
+   @param int col - column of the cell
+   @param char ch - what the cell holds
+*/
+void addCell( MapStats *stats, int row, int col, char ch );
+
+
+/**
+   This function moves the bounding box after expandMap has shifted the map down or right.
+   @param MapStats *stats - the statistics to update
+   @param int shiftRows - amount the rows were shifted downward
+   @param int shiftCols - amount the columns were shifted rightward
+*/
+void shiftStats( MapStats *stats, int shiftRows, int shiftCols );
+
+
+/**
+   This function prints map statistics as one line, in the form
+   "area=N walls=N items=a:N,b:N box=top,left,bottom,right" (box=- when nothing is known).
+   @param FILE *fp - the stream to print to
+   @param MapStats *stats - the statistics to print
+*/
+void printStats( FILE *fp, MapStats *stats );
+
+#endif
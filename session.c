@@ -0,0 +1,1210 @@
+/**
+   @file session.c
+   @author Louis Warner (elwarner)
+   This file contains the explorer engine behind libexplorer.a. All of the state for a map and its
+   player lives in an ExplorerSession, so any number of sessions can run side by side.
+
+   The map is kept in one buffer with room to grow on every side. Cells outside the visible map are
+   always ' ', and growing the map only moves its edges until the buffer is full, when the buffer is
+   doubled. Commands check everything they are about to write before writing any of it, so an
+   inconsistent command is refused without a saved copy of the map to roll back to. Together these
+   mean a command does no heap allocation once the buffer is big enough.
+
+   A session can also be marked, and later put back to the mark. While there are marks, every cell
+   and frontier flag that is overwritten goes into an undo log with its old value, and going back
+   replays the log backwards, so it costs as much as the commands did and nothing is copied whole.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "map.h"
+#include "world.h"
+#include "explorer.h"
+
+//Most cells that can change between two frames: the three the player sees and the player's old and new cells.
+#define CHANGE_LIMIT 5
+
+/**
+   A loaded world, shared (read-only) by a session and all of its copies.
+ */
+typedef struct {
+  char **cells;
+  int rows;
+  int cols;
+  int startRow;
+  int startCol;
+  int users;
+} World;
+
+/**
+   One entry of the undo log: a map cell (by its row and column counted from the cell that was at the
+   top left before any growth at the top or left) or a frontier flag (by world index), and its old value.
+ */
+typedef struct {
+  int row;
+  int col;
+  char old;
+  char isFrontier;
+} Undo;
+
+/**
+   The parts of a session that a mark saves whole, since they are small.
+ */
+typedef struct {
+  long logged;
+  int grownTop;
+  int grownLeft;
+  int rows;
+  int cols;
+  int row;
+  int col;
+  int dir;
+  int started;
+  MapStats stats;
+  int shown;
+  int shownRow;
+  int shownCol;
+  int addedRows;
+  int addedCols;
+  int shiftRows;
+  int shiftCols;
+  int changes;
+  int changed[2 * CHANGE_LIMIT];
+  int worldRow;
+  int worldCol;
+  int checkStart;
+  int frontierCount;
+} Mark;
+
+/**
+   Everything about one session. Map coordinates have (0, 0) at the top left of the visible map.
+ */
+struct ExplorerSession {
+  //The grid buffer, its size, and where the visible map sits in it.
+  char *cells;
+  int rowCap;
+  int colCap;
+  int top;
+  int left;
+  int rows;
+  int cols;
+
+  //Rows and columns the map has grown by at the top and left, which moves map coordinates.
+  int grownTop;
+  int grownLeft;
+
+  //The player, in map coordinates.
+  int row;
+  int col;
+  int dir;
+
+  //Whether the initial sight sequence has been seen yet.
+  int started;
+
+  //Running statistics for the known map.
+  MapStats stats;
+
+  //What has changed since the last frame was shown (see ExplorerView), and where the player was in it.
+  int shown;
+  int shownRow;
+  int shownCol;
+  int addedRows;
+  int addedCols;
+  int shiftRows;
+  int shiftCols;
+  int changes;
+  int changed[2 * CHANGE_LIMIT];
+
+  //World mode: the world, the player's position in it, and whether the first line may repeat the initial sight.
+  World *world;
+  int worldRow;
+  int worldCol;
+  int checkStart;
+
+  //Known passable world cells next to unknown ones, kept up to date for explore.
+  char *frontier;
+  int frontierCount;
+
+  //Scratch space for explore's route search, one entry per world cell.
+  int *route;
+  int *queue;
+  int *seen;
+  char *from;
+  int search;
+
+  //Marks, most recent last, and the undo log that is kept while there are any.
+  Mark *marks;
+  int markCount;
+  int markCap;
+  Undo *log;
+  long logged;
+  long logCap;
+
+  ExplorerSinks sinks;
+};
+
+
+/**
+   Gives the direction the player faces after turning left.
+   @param int from - the current direction
+   @return int to - the new direction
+ */
+static int leftOf( int from ){
+  if( from == NORTH ){
+    return WEST;
+  } else if( from == WEST ){
+    return SOUTH;
+  } else if( from == SOUTH ){
+    return EAST;
+  }
+  return NORTH;
+}
+
+/**
+   Gives the direction the player faces after turning right.
+   @param int from - the current direction
+   @return int to - the new direction
+ */
+static int rightOf( int from ){
+  return leftOf( leftOf( leftOf( from ) ) );
+}
+
+/**
+   Gives the change in row for one step in the given direction.
+   @param int to - direction of the step
+   @return int step - -1, 0 or 1
+ */
+static int rowStep( int to ){
+  return to == NORTH ? -1 : to == SOUTH ? 1 : 0;
+}
+
+/**
+   Gives the change in column for one step in the given direction.
+   @param int to - direction of the step
+   @return int step - -1, 0 or 1
+ */
+static int colStep( int to ){
+  return to == WEST ? -1 : to == EAST ? 1 : 0;
+}
+
+/**
+   Gives the offset from the player of one cell in the strip the player sees, in the same
+   left-to-right order as a sight sequence.
+   @param int dir - direction the player faces
+   @param int i - position in the strip (0, 1 or 2)
+   @param int *dr - set to the change in row
+   @param int *dc - set to the change in column
+ */
+static void stripCell( int dir, int i, int *dr, int *dc ){
+  if( dir == NORTH ){
+    *dr = -1;
+    *dc = -1 + i;
+  } else if( dir == SOUTH ){
+    *dr = 1;
+    *dc = 1 - i;
+  } else if( dir == EAST ){
+    *dr = -1 + i;
+    *dc = 1;
+  } else {
+    *dr = 1 - i;
+    *dc = -1;
+  }
+}
+
+/**
+   Gives the arrow drawn for the player facing the given direction.
+   @param int dir - direction the player faces
+   @return char arrow - '^', 'V', '>' or '<'
+ */
+static char arrowOf( int dir ){
+  return dir == NORTH ? '^' : dir == SOUTH ? 'V' : dir == EAST ? '>' : '<';
+}
+
+/**
+   Checks for a valid sight sequence: three characters that are each '.', '#' or a lowercase letter (item).
+   @param const char *sight - the sequence to check
+   @return int valid - 0 for false or 1 for true
+ */
+static int isValidSequence( const char *sight ){
+  for( int i = 0; i < 3; i++ ){
+    if( sight[i] != '.' && sight[i] != '#' && !( sight[i] >= 'a' && sight[i] <= 'z' ) ){
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+   Gives the contents of a map cell. Cells outside the visible map are unknown.
+   @param ExplorerSession *s - the session
+   @param int r - row of the cell
+   @param int c - column of the cell
+   @return char cell - the cell, or ' ' if unknown
+ */
+static char cellAt( ExplorerSession *s, int r, int c ){
+  if( r < 0 || r >= s->rows || c < 0 || c >= s->cols ){
+    return ' ';
+  }
+  return s->cells[( s->top + r ) * s->colCap + s->left + c];
+}
+
+/**
+   Notes a cell that is different from the last frame, keeping the list in row-major order
+   without repeats. If the list would overflow, the next frame is sent as a first frame instead.
+   @param ExplorerSession *s - the session
+   @param int r - row of the cell
+   @param int c - column of the cell
+ */
+static void noteChange( ExplorerSession *s, int r, int c ){
+  int i = s->changes;
+  if( i < 0 ){
+    return;
+  }
+  while( i > 0 && ( s->changed[2 * i - 2] > r || ( s->changed[2 * i - 2] == r && s->changed[2 * i - 1] > c ) ) ){
+    i--;
+  }
+  if( i > 0 && s->changed[2 * i - 2] == r && s->changed[2 * i - 1] == c ){
+    return;
+  }
+  if( s->changes == CHANGE_LIMIT ){
+    s->changes = -1;
+    return;
+  }
+  memmove( s->changed + 2 * i + 2, s->changed + 2 * i, ( s->changes - i ) * 2 * sizeof( int ) );
+  s->changed[2 * i] = r;
+  s->changed[2 * i + 1] = c;
+  s->changes++;
+}
+
+/**
+   Adds an entry to the undo log, if the session has any marks.
+   @param ExplorerSession *s - the session
+   @param int row - row of the cell, counted as in Undo, or its world index for a frontier flag
+   @param int col - column of the cell (unused for a frontier flag)
+   @param char old - the value being overwritten
+   @param char isFrontier - 1 for a frontier flag, 0 for a map cell
+ */
+static void logUndo( ExplorerSession *s, int row, int col, char old, char isFrontier ){
+  if( s->markCount == 0 ){
+    return;
+  }
+  if( s->logged == s->logCap ){
+    s->logCap = s->logCap ? 2 * s->logCap : 1024;
+    s->log = (Undo *) realloc( s->log, s->logCap * sizeof( Undo ) );
+  }
+  s->log[s->logged].row = row;
+  s->log[s->logged].col = col;
+  s->log[s->logged].old = old;
+  s->log[s->logged].isFrontier = isFrontier;
+  s->logged++;
+}
+
+/**
+   Writes one cell the player can see, counting it in the statistics if it was unknown.
+   @param ExplorerSession *s - the session
+   @param int r - row of the cell
+   @param int c - column of the cell
+   @param char ch - what the player sees there
+ */
+static void setCell( ExplorerSession *s, int r, int c, char ch ){
+  char *cell = s->cells + ( s->top + r ) * s->colCap + s->left + c;
+  if( *cell == ' ' ){
+    addCell( &s->stats, r, c, ch );
+  }
+  if( *cell != ch ){
+    noteChange( s, r, c );
+    logUndo( s, r - s->grownTop, c - s->grownLeft, *cell, 0 );
+  }
+  *cell = ch;
+}
+
+/**
+   Moves the cells noted for the next frame, and the player's place in the last one, after the map
+   has grown at the top or left.
+   @param ExplorerSession *s - the session
+   @param int shiftRows - rows added at the top
+   @param int shiftCols - columns added on the left
+ */
+static void shiftChanges( ExplorerSession *s, int shiftRows, int shiftCols ){
+  for( int i = 0; i < s->changes; i++ ){
+    s->changed[2 * i] += shiftRows;
+    s->changed[2 * i + 1] += shiftCols;
+  }
+  s->shownRow += shiftRows;
+  s->shownCol += shiftCols;
+  s->shiftRows += shiftRows;
+  s->shiftCols += shiftCols;
+}
+
+/**
+   Makes sure the grid buffer has room for the map to grow by the given amounts, doubling it if not.
+   @param ExplorerSession *s - the session
+   @param int addTop - rows to be added above
+   @param int addBottom - rows to be added below
+   @param int addLeft - columns to be added on the left
+   @param int addRight - columns to be added on the right
+ */
+static void makeRoom( ExplorerSession *s, int addTop, int addBottom, int addLeft, int addRight ){
+  if( s->top >= addTop && s->top + s->rows + addBottom <= s->rowCap &&
+      s->left >= addLeft && s->left + s->cols + addRight <= s->colCap ){
+    return;
+  }
+
+  //Double the buffer and center the map in it.
+  int rowCap = 2 * ( s->rows + addTop + addBottom );
+  int colCap = 2 * ( s->cols + addLeft + addRight );
+  int top = ( rowCap - s->rows ) / 2;
+  int left = ( colCap - s->cols ) / 2;
+  char *cells = (char *) malloc( rowCap * colCap );
+  memset( cells, ' ', rowCap * colCap );
+  for( int i = 0; i < s->rows; i++ ){
+    memcpy( cells + ( top + i ) * colCap + left, s->cells + ( s->top + i ) * s->colCap + s->left, s->cols );
+  }
+  free( s->cells );
+  s->cells = cells;
+  s->rowCap = rowCap;
+  s->colCap = colCap;
+  s->top = top;
+  s->left = left;
+}
+
+/**
+   Grows the map by one row or column, as the player reaches an edge. Growing at the top or left
+   shifts the map (and the player) down or right, like expandMap.
+   @param ExplorerSession *s - the session
+   @param int dir - which edge to grow
+ */
+static void growMap( ExplorerSession *s, int dir ){
+  if( dir == NORTH ){
+    makeRoom( s, 1, 0, 0, 0 );
+    s->top--;
+    s->rows++;
+    s->row++;
+    s->grownTop++;
+    s->addedRows++;
+    shiftStats( &s->stats, 1, 0 );
+    shiftChanges( s, 1, 0 );
+  } else if( dir == SOUTH ){
+    makeRoom( s, 0, 1, 0, 0 );
+    s->rows++;
+    s->addedRows++;
+  } else if( dir == EAST ){
+    makeRoom( s, 0, 0, 0, 1 );
+    s->cols++;
+    s->addedCols++;
+  } else {
+    makeRoom( s, 0, 0, 1, 0 );
+    s->left--;
+    s->cols++;
+    s->col++;
+    s->grownLeft++;
+    s->addedCols++;
+    shiftStats( &s->stats, 0, 1 );
+    shiftChanges( s, 0, 1 );
+  }
+}
+
+/**
+   Hands the map to the frame sink, with the player's arrow drawn in and what changed since the
+   last frame, then starts noting changes for the next one.
+   @param ExplorerSession *s - the session
+ */
+static void showFrame( ExplorerSession *s ){
+  ExplorerView view;
+  char *cell;
+  char under;
+
+  //The arrow moved or turned, so both its old and new cells are different.
+  if( s->shown ){
+    noteChange( s, s->shownRow, s->shownCol );
+  }
+  noteChange( s, s->row, s->col );
+  if( s->sinks.frame ){
+    cell = s->cells + ( s->top + s->row ) * s->colCap + s->left + s->col;
+    under = *cell;
+    *cell = arrowOf( s->dir );
+    view.grid = s->cells + s->top * s->colCap + s->left;
+    view.stride = s->colCap;
+    view.rows = s->rows;
+    view.cols = s->cols;
+    view.row = s->row;
+    view.col = s->col;
+    view.dir = s->dir;
+    view.addedRows = s->addedRows;
+    view.addedCols = s->addedCols;
+    view.shiftRows = s->shiftRows;
+    view.shiftCols = s->shiftCols;
+    view.changes = s->shown ? s->changes : -1;
+    view.changed = s->changed;
+    s->sinks.frame( s->sinks.context, &view );
+    *cell = under;
+  }
+  s->shown = 1;
+  s->shownRow = s->row;
+  s->shownCol = s->col;
+  s->addedRows = s->addedCols = 0;
+  s->shiftRows = s->shiftCols = 0;
+  s->changes = 0;
+}
+
+/**
+   Checks the running statistics against a full recount of the map. This is only compiled in
+   with -DDEBUG_STATS, since the recount looks at every cell.
+   @param ExplorerSession *s - the session
+ */
+static void checkStats( ExplorerSession *s ){
+#ifdef DEBUG_STATS
+  MapStats count;
+  initStats( &count );
+  for( int i = 0; i < s->rows; i++ ){
+    for( int j = 0; j < s->cols; j++ ){
+      if( cellAt( s, i, j ) != ' ' ){
+        addCell( &count, i, j, cellAt( s, i, j ) );
+      }
+    }
+  }
+  if( memcmp( &count, &s->stats, sizeof( MapStats ) ) ){
+    fprintf( stderr, "Map statistics do not match a recount\n" );
+    abort();
+  }
+#endif
+}
+
+/**
+   Checks whether a sight sequence agrees with what the map already knows, for a player at the given cell.
+   @param ExplorerSession *s - the session
+   @param int r - row of the player
+   @param int c - column of the player
+   @param int dir - direction of the player
+   @param const char *sight - the sequence
+   @return int fits - 0 for false or 1 for true
+ */
+static int sightFits( ExplorerSession *s, int r, int c, int dir, const char *sight ){
+  int dr;
+  int dc;
+  for( int i = 0; i < 3; i++ ){
+    stripCell( dir, i, &dr, &dc );
+    char known = cellAt( s, r + dr, c + dc );
+    if( known != ' ' && known != sight[i] ){
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+   Writes the sight sequence into the strip in front of the player.
+   @param ExplorerSession *s - the session
+   @param const char *sight - the sequence
+ */
+static void writeSight( ExplorerSession *s, const char *sight ){
+  int dr;
+  int dc;
+  for( int i = 0; i < 3; i++ ){
+    stripCell( s->dir, i, &dr, &dc );
+    setCell( s, s->row + dr, s->col + dc, sight[i] );
+  }
+}
+
+
+/**
+   Gives what the map currently shows for a world cell. Cells outside the map are unknown, and
+   the player's own cell counts as passable.
+   @param ExplorerSession *s - the session
+   @param int r - world row of the cell
+   @param int c - world column of the cell
+   @return char cell - the map contents, or ' ' if unknown
+ */
+static char knownCell( ExplorerSession *s, int r, int c ){
+  int mapRow = r - s->worldRow + s->row;
+  int mapCol = c - s->worldCol + s->col;
+  if( mapRow == s->row && mapCol == s->col ){
+    return arrowOf( s->dir );
+  }
+  return cellAt( s, mapRow, mapCol );
+}
+
+/**
+   Checks whether a map character is somewhere the player can stand (including the player's own cell).
+   @param char ch - the map character
+   @return int passable - 0 for false or 1 for true
+ */
+static int isPassable( char ch ){
+  return ch == '.' || ( ch >= 'a' && ch <= 'z' ) || ch == '^' || ch == 'V' || ch == '<' || ch == '>';
+}
+
+/**
+   Recomputes whether one world cell is on the frontier: known, passable and next to an unknown cell.
+   @param ExplorerSession *s - the session
+   @param int r - world row of the cell
+   @param int c - world column of the cell
+ */
+static void updateFrontier( ExplorerSession *s, int r, int c ){
+  int onFrontier = 0;
+  if( r < 0 || r >= s->world->rows || c < 0 || c >= s->world->cols ){
+    return;
+  }
+  if( isPassable( knownCell( s, r, c ) ) ){
+    onFrontier = knownCell( s, r - 1, c ) == ' ' || knownCell( s, r + 1, c ) == ' ' ||
+                 knownCell( s, r, c - 1 ) == ' ' || knownCell( s, r, c + 1 ) == ' ';
+  }
+  char *flag = s->frontier + r * s->world->cols + c;
+  if( *flag != onFrontier ){
+    logUndo( s, r * s->world->cols + c, 0, *flag, 1 );
+  }
+  s->frontierCount += onFrontier - *flag;
+  *flag = onFrontier;
+}
+
+/**
+   Recomputes the frontier around a world cell whose map contents may have changed.
+   @param ExplorerSession *s - the session
+   @param int r - world row of the cell
+   @param int c - world column of the cell
+ */
+static void touchFrontier( ExplorerSession *s, int r, int c ){
+  updateFrontier( s, r, c );
+  updateFrontier( s, r - 1, c );
+  updateFrontier( s, r + 1, c );
+  updateFrontier( s, r, c - 1 );
+  updateFrontier( s, r, c + 1 );
+}
+
+/**
+   Updates the frontier after a successful command, from the cells the player just saw and the
+   cell the player is standing on. Only done in world mode, where the frontier exists.
+   @param ExplorerSession *s - the session
+ */
+static void touchSight( ExplorerSession *s ){
+  int dr;
+  int dc;
+  if( !s->world ){
+    return;
+  }
+  touchFrontier( s, s->worldRow, s->worldCol );
+  for( int i = 0; i < 3; i++ ){
+    stripCell( s->dir, i, &dr, &dc );
+    touchFrontier( s, s->worldRow + dr, s->worldCol + dc );
+  }
+}
+
+/**
+   Works out the sight sequence for a movement command. In world mode the sequence is derived
+   from the world for the position and direction the player would have after the command, and
+   a sequence given by the caller is checked against it.
+   @param ExplorerSession *s - the session
+   @param const char *given - sequence given by the caller, or NULL if there was none
+   @param int toRow - world row of the player after the command
+   @param int toCol - world column of the player after the command
+   @param int toDir - direction of the player after the command
+   @param char sight[4] - filled with the sequence to use
+   @return int status - EXPLORER_OK, EXPLORER_INVALID or EXPLORER_INCONSISTENT
+ */
+static int getSight( ExplorerSession *s, const char *given, int toRow, int toCol, int toDir, char sight[4] ){
+  if( !s->started || ( given && !isValidSequence( given ) ) ){
+    return EXPLORER_INVALID;
+  }
+  if( !s->world ){
+    if( !given ){
+      return EXPLORER_INVALID;
+    }
+    memcpy( sight, given, 3 );
+    sight[3] = '\0';
+    return EXPLORER_OK;
+  }
+  worldSight( s->world->cells, s->world->rows, s->world->cols, toRow, toCol, toDir, sight );
+  if( given && memcmp( given, sight, 3 ) ){
+    return EXPLORER_INCONSISTENT;
+  }
+  return EXPLORER_OK;
+}
+
+/**
+   Switches the world-related memory of a session to another world (or none), sharing the world itself.
+   @param ExplorerSession *s - the session
+   @param World *world - the new world, or NULL
+ */
+static void setWorld( ExplorerSession *s, World *world ){
+  if( s->world == world ){
+    return;
+  }
+  if( s->world ){
+    if( --s->world->users == 0 ){
+      freeMap( s->world->cells, s->world->rows );
+      free( s->world );
+    }
+    free( s->frontier );
+    free( s->route );
+    free( s->queue );
+    free( s->seen );
+    free( s->from );
+    s->frontier = NULL;
+    s->route = s->queue = s->seen = NULL;
+    s->from = NULL;
+  }
+  s->world = world;
+  if( world ){
+    int size = world->rows * world->cols;
+    world->users++;
+    s->frontier = (char *) calloc( size, 1 );
+    s->route = (int *) malloc( size * sizeof( int ) );
+    s->queue = (int *) malloc( size * sizeof( int ) );
+    s->seen = (int *) calloc( size, sizeof( int ) );
+    s->from = (char *) malloc( size );
+    s->search = 0;
+  }
+}
+
+
+/**
+   This function creates a new session, with nothing known and the player facing north.
+   @param ExplorerSinks *sinks - where output goes (copied), or NULL for none
+   @return ExplorerSession *session - the new session
+ */
+ExplorerSession *explorerCreate( ExplorerSinks *sinks ){
+  ExplorerSession *s = (ExplorerSession *) calloc( 1, sizeof( ExplorerSession ) );
+
+  //Start with the 3x3 map, player in the middle, and room to grow.
+  s->rows = INITIAL_MAP_SIZE;
+  s->cols = INITIAL_MAP_SIZE;
+  s->rowCap = 4 * INITIAL_MAP_SIZE;
+  s->colCap = 4 * INITIAL_MAP_SIZE;
+  s->top = ( s->rowCap - s->rows ) / 2;
+  s->left = ( s->colCap - s->cols ) / 2;
+  s->cells = (char *) malloc( s->rowCap * s->colCap );
+  memset( s->cells, ' ', s->rowCap * s->colCap );
+  s->row = 1;
+  s->col = 1;
+  s->dir = NORTH;
+  initStats( &s->stats );
+  if( sinks ){
+    s->sinks = *sinks;
+  }
+  return s;
+}
+
+/**
+   This function frees a session and everything it holds.
+   @param ExplorerSession *session - the session to free
+ */
+void explorerFree( ExplorerSession *session ){
+  setWorld( session, NULL );
+  free( session->cells );
+  free( session->marks );
+  free( session->log );
+  free( session );
+}
+
+/**
+   This function creates a new session that is an exact copy of another, sinks included.
+   @param ExplorerSession *session - the session to copy
+   @return ExplorerSession *copy - the new session
+ */
+ExplorerSession *explorerClone( ExplorerSession *session ){
+  ExplorerSession *copy = explorerCreate( &session->sinks );
+  explorerCopy( copy, session );
+  return copy;
+}
+
+/**
+   This function makes one session an exact copy of another, reusing its memory where it can.
+   Both sessions must have the same world (or no world). The copy has no marks.
+   @param ExplorerSession *to - the session to overwrite
+   @param ExplorerSession *from - the session to copy
+ */
+void explorerCopy( ExplorerSession *to, ExplorerSession *from ){
+  //Copy the whole grid buffer, so cells outside the map stay unknown.
+  if( to->rowCap * to->colCap != from->rowCap * from->colCap ){
+    free( to->cells );
+    to->cells = (char *) malloc( from->rowCap * from->colCap );
+  }
+  memcpy( to->cells, from->cells, from->rowCap * from->colCap );
+  to->rowCap = from->rowCap;
+  to->colCap = from->colCap;
+  to->top = from->top;
+  to->left = from->left;
+  to->rows = from->rows;
+  to->cols = from->cols;
+  to->grownTop = from->grownTop;
+  to->grownLeft = from->grownLeft;
+  to->row = from->row;
+  to->col = from->col;
+  to->dir = from->dir;
+  to->started = from->started;
+  to->stats = from->stats;
+  to->shown = from->shown;
+  to->shownRow = from->shownRow;
+  to->shownCol = from->shownCol;
+  to->addedRows = from->addedRows;
+  to->addedCols = from->addedCols;
+  to->shiftRows = from->shiftRows;
+  to->shiftCols = from->shiftCols;
+  to->changes = from->changes;
+  memcpy( to->changed, from->changed, sizeof( from->changed ) );
+
+  //Share the world, and copy the frontier that goes with this map.
+  setWorld( to, from->world );
+  if( from->world ){
+    memcpy( to->frontier, from->frontier, from->world->rows * from->world->cols );
+  }
+  to->worldRow = from->worldRow;
+  to->worldCol = from->worldCol;
+  to->checkStart = from->checkStart;
+  to->frontierCount = from->frontierCount;
+  to->sinks = from->sinks;
+  to->markCount = 0;
+  to->logged = 0;
+}
+
+/**
+   This function marks the current state of a session, so that explorerUndo can put it back.
+   Marks nest, and while a session has any, every command also records what it overwrites.
+   explorerLoadWorld is not undone, so a world should be loaded before the first mark.
+   @param ExplorerSession *session - the session
+ */
+void explorerMark( ExplorerSession *session ){
+  ExplorerSession *s = session;
+  if( s->markCount == s->markCap ){
+    s->markCap = s->markCap ? 2 * s->markCap : 16;
+    s->marks = (Mark *) realloc( s->marks, s->markCap * sizeof( Mark ) );
+  }
+  Mark *mark = s->marks + s->markCount++;
+  mark->logged = s->logged;
+  mark->grownTop = s->grownTop;
+  mark->grownLeft = s->grownLeft;
+  mark->rows = s->rows;
+  mark->cols = s->cols;
+  mark->row = s->row;
+  mark->col = s->col;
+  mark->dir = s->dir;
+  mark->started = s->started;
+  mark->stats = s->stats;
+  mark->shown = s->shown;
+  mark->shownRow = s->shownRow;
+  mark->shownCol = s->shownCol;
+  mark->addedRows = s->addedRows;
+  mark->addedCols = s->addedCols;
+  mark->shiftRows = s->shiftRows;
+  mark->shiftCols = s->shiftCols;
+  mark->changes = s->changes;
+  memcpy( mark->changed, s->changed, sizeof( s->changed ) );
+  mark->worldRow = s->worldRow;
+  mark->worldCol = s->worldCol;
+  mark->checkStart = s->checkStart;
+  mark->frontierCount = s->frontierCount;
+}
+
+/**
+   This function puts a session back to the state of its most recent mark, which is kept, so it
+   can be gone back to again. The time it takes is proportional to what changed since the mark.
+   @param ExplorerSession *session - the session, which must have a mark
+ */
+void explorerUndo( ExplorerSession *session ){
+  ExplorerSession *s = session;
+  Mark *mark = s->marks + s->markCount - 1;
+
+  //Put back every cell and frontier flag written since the mark, newest first.
+  while( s->logged > mark->logged ){
+    Undo *undo = s->log + --s->logged;
+    if( undo->isFrontier ){
+      s->frontier[undo->row] = undo->old;
+    } else {
+      s->cells[( s->top + s->grownTop + undo->row ) * s->colCap + s->left + s->grownLeft + undo->col] = undo->old;
+    }
+  }
+
+  //Growth since the mark only moved the edges of the map in the buffer, so move them back.
+  s->top += s->grownTop - mark->grownTop;
+  s->left += s->grownLeft - mark->grownLeft;
+  s->grownTop = mark->grownTop;
+  s->grownLeft = mark->grownLeft;
+  s->rows = mark->rows;
+  s->cols = mark->cols;
+  s->row = mark->row;
+  s->col = mark->col;
+  s->dir = mark->dir;
+  s->started = mark->started;
+  s->stats = mark->stats;
+  s->shown = mark->shown;
+  s->shownRow = mark->shownRow;
+  s->shownCol = mark->shownCol;
+  s->addedRows = mark->addedRows;
+  s->addedCols = mark->addedCols;
+  s->shiftRows = mark->shiftRows;
+  s->shiftCols = mark->shiftCols;
+  s->changes = mark->changes;
+  memcpy( s->changed, mark->changed, sizeof( s->changed ) );
+  s->worldRow = mark->worldRow;
+  s->worldCol = mark->worldCol;
+  s->checkStart = mark->checkStart;
+  s->frontierCount = mark->frontierCount;
+}
+
+/**
+   This function forgets the most recent mark of a session, without changing the session.
+   @param ExplorerSession *session - the session, which must have a mark
+ */
+void explorerDrop( ExplorerSession *session ){
+  if( --session->markCount == 0 ){
+    session->logged = 0;
+  }
+}
+
+/**
+   This function starts the map from the initial sight sequence.
+   @param ExplorerSession *session - the session
+   @param const char *sight - the 3 characters the player sees at the start
+   @return int status - EXPLORER_OK, or EXPLORER_INVALID if the sequence is not valid or the map has already started
+ */
+int explorerStart( ExplorerSession *session, const char *sight ){
+  if( session->started || !isValidSequence( sight ) ){
+    return EXPLORER_INVALID;
+  }
+  writeSight( session, sight );
+  session->started = 1;
+  showFrame( session );
+  return EXPLORER_OK;
+}
+
+/**
+   This function switches a session to world mode: the world is read from the file, the map is
+   started from the player's view in it, and from then on sight sequences may be left out and
+   are checked against the world when given. It must be called before any other command.
+   @param ExplorerSession *session - the session
+   @param FILE *fp - the world file (see loadWorld in world.h)
+   @return int status - EXPLORER_OK, or EXPLORER_INVALID if the file is not a valid world
+ */
+int explorerLoadWorld( ExplorerSession *session, FILE *fp ){
+  World *world;
+  char sight[4];
+  if( session->started || session->world ){
+    return EXPLORER_INVALID;
+  }
+  world = (World *) calloc( 1, sizeof( World ) );
+  world->cells = loadWorld( fp, &world->rows, &world->cols, &world->startRow, &world->startCol );
+  if( !world->cells ){
+    free( world );
+    return EXPLORER_INVALID;
+  }
+  setWorld( session, world );
+  session->worldRow = world->startRow;
+  session->worldCol = world->startCol;
+
+  //Start from what the player sees, then build the frontier once. Every command after this updates it.
+  worldSight( world->cells, world->rows, world->cols, session->worldRow, session->worldCol, session->dir, sight );
+  explorerStart( session, sight );
+  session->frontierCount = 0;
+  for( int i = 0; i < world->rows; i++ ){
+    for( int j = 0; j < world->cols; j++ ){
+      updateFrontier( session, i, j );
+    }
+  }
+  session->checkStart = 1;
+  return EXPLORER_OK;
+}
+
+/**
+   This function moves the player forward one cell.
+   @param ExplorerSession *session - the session
+   @param const char *sight - the 3 characters seen after the move, or NULL in world mode
+   @return int status - EXPLORER_OK, EXPLORER_BLOCKED, EXPLORER_INVALID or EXPLORER_INCONSISTENT
+ */
+int explorerForward( ExplorerSession *session, const char *sight ){
+  ExplorerSession *s = session;
+  char seen[4];
+  int dr = rowStep( s->dir );
+  int dc = colStep( s->dir );
+  int status = getSight( s, sight, s->worldRow + dr, s->worldCol + dc, s->dir, seen );
+  if( status == EXPLORER_INVALID ){
+    return status;
+  }
+  if( cellAt( s, s->row + dr, s->col + dc ) == '#' ){
+    return EXPLORER_BLOCKED;
+  }
+  if( status != EXPLORER_OK || !sightFits( s, s->row + dr, s->col + dc, s->dir, seen ) ){
+    return EXPLORER_INCONSISTENT;
+  }
+
+  //Make the move, growing the map if the player reached an edge.
+  s->row += dr;
+  s->col += dc;
+  if( ( s->dir == NORTH && s->row == 0 ) || ( s->dir == SOUTH && s->row == s->rows - 1 ) ||
+      ( s->dir == EAST && s->col == s->cols - 1 ) || ( s->dir == WEST && s->col == 0 ) ){
+    growMap( s, s->dir );
+  }
+  writeSight( s, seen );
+  if( s->world ){
+    s->worldRow += dr;
+    s->worldCol += dc;
+    touchFrontier( s, s->worldRow - dr, s->worldCol - dc );
+    touchSight( s );
+  }
+  showFrame( s );
+  return EXPLORER_OK;
+}
+
+/**
+   Turns the player to face a new direction, checking what the player sees there.
+   @param ExplorerSession *s - the session
+   @param const char *sight - the 3 characters seen after the turn, or NULL in world mode
+   @param int to - the new direction
+   @return int status - EXPLORER_OK, EXPLORER_INVALID or EXPLORER_INCONSISTENT
+ */
+static int turn( ExplorerSession *s, const char *sight, int to ){
+  char seen[4];
+  int status = getSight( s, sight, s->worldRow, s->worldCol, to, seen );
+  if( status != EXPLORER_OK ){
+    return status;
+  }
+  if( !sightFits( s, s->row, s->col, to, seen ) ){
+    return EXPLORER_INCONSISTENT;
+  }
+  s->dir = to;
+  writeSight( s, seen );
+  touchSight( s );
+  showFrame( s );
+  return EXPLORER_OK;
+}
+
+/**
+   This function turns the player left.
+   @param ExplorerSession *session - the session
+   @param const char *sight - the 3 characters seen after the turn, or NULL in world mode
+   @return int status - EXPLORER_OK, EXPLORER_INVALID or EXPLORER_INCONSISTENT
+ */
+int explorerLeft( ExplorerSession *session, const char *sight ){
+  return turn( session, sight, leftOf( session->dir ) );
+}
+
+/**
+   This function turns the player right.
+   @param ExplorerSession *session - the session
+   @param const char *sight - the 3 characters seen after the turn, or NULL in world mode
+   @return int status - EXPLORER_OK, EXPLORER_INVALID or EXPLORER_INCONSISTENT
+ */
+int explorerRight( ExplorerSession *session, const char *sight ){
+  return turn( session, sight, rightOf( session->dir ) );
+}
+
+/**
+   Finds a shortest route over known passable cells from the player to the nearest frontier cell,
+   using the session's scratch space.
+   @param ExplorerSession *s - the session
+   @param int *target - set to the world index (row * cols + col) of the frontier cell
+   @return int length - number of steps on the route (left in s->route), or -1 if no frontier cell can be reached
+ */
+static int planRoute( ExplorerSession *s, int *target ){
+  int directions[4] = { NORTH, EAST, SOUTH, WEST };
+  int worldRows = s->world->rows;
+  int worldCols = s->world->cols;
+  int search = ++s->search;
+  int head = 0;
+  int tail = 0;
+  int start = s->worldRow * worldCols + s->worldCol;
+
+  //Breadth-first search outward from the player, stopping at the first frontier cell.
+  s->queue[tail++] = start;
+  s->seen[start] = search;
+  while( head < tail ){
+    int cell = s->queue[head++];
+    int r = cell / worldCols;
+    int c = cell % worldCols;
+    if( s->frontier[cell] ){
+      //Walk back to the player to recover the route, then put it in order.
+      int length = 0;
+      *target = cell;
+      while( cell != start ){
+        int to = s->from[cell];
+        s->route[length++] = to;
+        cell -= rowStep( to ) * worldCols + colStep( to );
+      }
+      for( int i = 0; i < length / 2; i++ ){
+        int swap = s->route[i];
+        s->route[i] = s->route[length - 1 - i];
+        s->route[length - 1 - i] = swap;
+      }
+      return length;
+    }
+    for( int i = 0; i < 4; i++ ){
+      int nextRow = r + rowStep( directions[i] );
+      int nextCol = c + colStep( directions[i] );
+      int next = nextRow * worldCols + nextCol;
+      if( nextRow >= 0 && nextRow < worldRows && nextCol >= 0 && nextCol < worldCols &&
+          s->seen[next] != search && isPassable( knownCell( s, nextRow, nextCol ) ) ){
+        s->seen[next] = search;
+        s->from[next] = directions[i];
+        s->queue[tail++] = next;
+      }
+    }
+  }
+  return -1;
+}
+
+/**
+   This function explores the world on its own (world mode only): it repeatedly follows a route to the
+   nearest known passable cell next to an unknown one and turns to reveal it, until nothing reachable
+   is unknown or the step budget runs out.
+   @param ExplorerSession *session - the session
+   @param int budget - most moves and turns to take, or -1 for no limit
+   @return int status - EXPLORER_OK, or EXPLORER_INVALID outside world mode
+ */
+int explorerExplore( ExplorerSession *session, int budget ){
+  ExplorerSession *s = session;
+  int length = 0;
+  int next = 0;
+  int target = -1;
+  int steps = 0;
+  int to;
+
+  if( !s->world ){
+    return EXPLORER_INVALID;
+  }
+  while( s->frontierCount > 0 && ( budget < 0 || steps < budget ) ){
+    //Plan a new route once the old target is reached and used up.
+    if( target < 0 || !s->frontier[target] ){
+      length = planRoute( s, &target );
+      next = 0;
+      if( length < 0 ){
+        break;
+      }
+    }
+
+    //Follow the route, or at the target face an unknown neighbour to reveal it.
+    if( next < length ){
+      to = s->route[next];
+    } else if( knownCell( s, s->worldRow + rowStep( rightOf( s->dir ) ), s->worldCol + colStep( rightOf( s->dir ) ) ) == ' ' ){
+      to = rightOf( s->dir );
+    } else {
+      to = leftOf( s->dir );
+    }
+    if( to == s->dir ){
+      if( explorerForward( s, NULL ) == EXPLORER_OK ){
+        next++;
+      } else {
+        target = -1;
+      }
+    } else if( to == rightOf( s->dir ) ){
+      explorerRight( s, NULL );
+    } else {
+      explorerLeft( s, NULL );
+    }
+    checkStats( s );
+    steps++;
+  }
+  return EXPLORER_OK;
+}
+
+/**
+   Checks whether a token is exactly the given word.
+   @param const char *token - start of the token
+   @param int length - length of the token
+   @param const char *word - the word
+   @return int same - 0 for false or 1 for true
+ */
+static int isWord( const char *token, int length, const char *word ){
+  return (int) strlen( word ) == length && !strncmp( token, word, length );
+}
+
+/**
+   This function runs one line of a movement script ("forward ...", "left", "explore 20", "stats", ...).
+   The line is not changed.
+   @param ExplorerSession *session - the session
+   @param const char *line - the line, without its newline
+   @return int status - the status of the command, or EXPLORER_QUIT for "quit"
+ */
+int explorerLine( ExplorerSession *session, const char *line ){
+  ExplorerSession *s = session;
+  const char *tokens[3];
+  int lengths[3];
+  int count = 0;
+  char sight[4];
+
+  checkStats( s );
+
+  //Split the line into at most two tokens; a third makes the line invalid.
+  while( *line ){
+    if( *line == ' ' || *line == '\t' || *line == '\r' ){
+      line++;
+    } else {
+      if( count == 3 ){
+        break;
+      }
+      tokens[count] = line;
+      while( *line && *line != ' ' && *line != '\t' && *line != '\r' ){
+        line++;
+      }
+      lengths[count] = line - tokens[count];
+      count++;
+    }
+  }
+  int hasSight = count == 2 && lengths[1] == 3;
+
+  //Blank lines are skipped.
+  if( count == 0 ){
+    return EXPLORER_OK;
+  }
+  if( count > 2 ){
+    return EXPLORER_INVALID;
+  }
+
+  //Nothing else is accepted until the map has its initial sight sequence.
+  if( !s->started ){
+    if( count == 1 && lengths[0] == 3 ){
+      return explorerStart( s, tokens[0] );
+    }
+    return EXPLORER_INVALID;
+  }
+
+  //In world mode the map starts from the world, but a script may still begin with the initial sequence.
+  if( s->checkStart ){
+    s->checkStart = 0;
+    if( count == 1 && lengths[0] == 3 && isValidSequence( tokens[0] ) ){
+      worldSight( s->world->cells, s->world->rows, s->world->cols, s->worldRow, s->worldCol, s->dir, sight );
+      return memcmp( tokens[0], sight, 3 ) ? EXPLORER_INCONSISTENT : EXPLORER_OK;
+    }
+  }
+
+  if( count == 2 && !hasSight && !isWord( tokens[0], lengths[0], "explore" ) ){
+    return EXPLORER_INVALID;
+  }
+  if( isWord( tokens[0], lengths[0], "forward" ) ){
+    return explorerForward( s, hasSight ? tokens[1] : NULL );
+  } else if( isWord( tokens[0], lengths[0], "right" ) ){
+    return explorerRight( s, hasSight ? tokens[1] : NULL );
+  } else if( isWord( tokens[0], lengths[0], "left" ) ){
+    return explorerLeft( s, hasSight ? tokens[1] : NULL );
+  } else if( isWord( tokens[0], lengths[0], "explore" ) && s->world ){
+    if( count == 1 ){
+      return explorerExplore( s, -1 );
+    }
+    //The budget must be a positive number of at most 9 digits.
+    int budget = 0;
+    if( lengths[1] > 9 ){
+      return EXPLORER_INVALID;
+    }
+    for( int i = 0; i < lengths[1]; i++ ){
+      if( tokens[1][i] < '0' || tokens[1][i] > '9' ){
+        return EXPLORER_INVALID;
+      }
+      budget = budget * 10 + tokens[1][i] - '0';
+    }
+    return budget > 0 ? explorerExplore( s, budget ) : EXPLORER_INVALID;
+  } else if( isWord( tokens[0], lengths[0], "stats" ) && count == 1 ){
+    if( s->sinks.stats ){
+      s->sinks.stats( s->sinks.context, &s->stats );
+    }
+    return EXPLORER_OK;
+  } else if( isWord( tokens[0], lengths[0], "quit" ) && count == 1 ){
+    return EXPLORER_QUIT;
+  }
+  return EXPLORER_INVALID;
+}
+
+/**
+   This function gets the running map statistics for a session.
+   @param ExplorerSession *session - the session
+   @param MapStats *stats - filled with the statistics
+ */
+void explorerStats( ExplorerSession *session, MapStats *stats ){
+  *stats = session->stats;
+}
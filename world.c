@@ -0,0 +1,153 @@
+/**
+   @file world.c
+   @author Louis Warner (elwarner)
+   This file contains helper functions for the explorer.c program's --world mode. It loads a known
+   world grid once and derives the sight strips a player would see in it, so scripts can be
+   checked against the truth with constant-time lookups.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "map.h"
+#include "world.h"
+
+/**
+   Checks whether a character may appear in a world file.
+   @param int ch - character to check
+   @return int valid - 0 for false or 1 for true
+ */
+static int isWorldChar( int ch ){
+  return ch == '.' || ch == '#' || ch == '^' || ( ch >= 'a' && ch <= 'z' );
+}
+
+/**
+   This function reads a world grid from the given file. Each line is one row made of '.', '#' and
+   lower-case letters, and exactly one '^' marks the starting cell of the player (facing north).
+   Short rows are padded with walls.
+   @param FILE *fp - the world file
+   @param int *rows - set to the height of the world
+   @param int *cols - set to the width of the world
+   @param int *startRow - set to the row of the starting cell
+   @param int *startCol - set to the column of the starting cell
+   @return char **world - the world grid, or NULL if the file is not a valid world
+ */
+char **loadWorld( FILE *fp, int *rows, int *cols, int *startRow, int *startCol ){
+  //Growable list of rows, and a growable buffer for the row being read.
+  int capacity = 16;
+  char **world = (char **) malloc( capacity * sizeof( char * ) );
+  int lineCap = 16;
+  int len = 0;
+  char *line = (char *) malloc( lineCap );
+  int starts = 0;
+  int valid = 1;
+  int ch;
+
+  *rows = 0;
+  *cols = 0;
+
+  //Read the file one character at a time, closing a row at every newline.
+  do {
+    ch = getc( fp );
+    if( ch == EOF || ch == '\n' ){
+      //Ignore a carriage return left by DOS line endings, and skip empty lines. A carriage
+      //return anywhere else in the row is not a world character.
+      if( len > 0 && line[len - 1] == '\r' ){
+        len--;
+      }
+      if( len > 0 ){
+        if( memchr( line, '\r', len ) ){
+          valid = 0;
+        }
+        if( *rows == capacity ){
+          capacity *= 2;
+          world = (char **) realloc( world, capacity * sizeof( char * ) );
+        }
+        line[len] = '\0';
+        world[*rows] = line;
+        (*rows)++;
+        if( len > *cols ){
+          *cols = len;
+        }
+        lineCap = 16;
+        line = (char *) malloc( lineCap );
+        len = 0;
+      }
+    } else {
+      if( !isWorldChar( ch ) && ch != '\r' ){
+        valid = 0;
+      }
+      if( ch == '^' ){
+        *startRow = *rows;
+        *startCol = len;
+        starts++;
+        ch = '.';
+      }
+      if( len + 1 == lineCap ){
+        lineCap *= 2;
+        line = (char *) realloc( line, lineCap );
+      }
+      line[len++] = ch;
+    }
+  } while( ch != EOF );
+  free( line );
+
+  //The world needs exactly one starting cell.
+  if( !valid || starts != 1 ){
+    freeMap( world, *rows );
+    return NULL;
+  }
+
+  //Pad short rows with walls so every row has the same width.
+  for( int i = 0; i < *rows; i++ ){
+    int oldLength = strlen( world[i] );
+    if( oldLength < *cols ){
+      world[i] = (char *) realloc( world[i], *cols + 1 );
+      memset( world[i] + oldLength, '#', *cols - oldLength );
+      world[i][*cols] = '\0';
+    }
+  }
+
+  return world;
+}
+
+/**
+   This function returns the contents of one world cell. Everything outside the grid is a wall.
+   @param char **world - the world grid
+   @param int rows - height of the world
+   @param int cols - width of the world
+   @param int r - row of the cell
+   @param int c - column of the cell
+   @return char cell - contents of the cell
+ */
+char worldCell( char **world, int rows, int cols, int r, int c ){
+  if( r < 0 || r >= rows || c < 0 || c >= cols ){
+    return '#';
+  }
+  return world[r][c];
+}
+
+/**
+   This function fills in the 3-character sight strip a player at the given world cell sees
+   when facing the given direction, in the same left-to-right order as a script line.
+   @param char **world - the world grid
+   @param int rows - height of the world
+   @param int cols - width of the world
+   @param int r - row of the player
+   @param int c - column of the player
+   @param int dir - direction of the player (NORTH, SOUTH, EAST, or WEST)
+   @param char sight[4] - filled with the strip and a null terminator
+ */
+void worldSight( char **world, int rows, int cols, int r, int c, int dir, char sight[4] ){
+  for( int i = 0; i < 3; i++ ){
+    if( dir == NORTH ){
+      sight[i] = worldCell( world, rows, cols, r - 1, c - 1 + i );
+    } else if( dir == SOUTH ){
+      sight[i] = worldCell( world, rows, cols, r + 1, c + 1 - i );
+    } else if( dir == EAST ){
+      sight[i] = worldCell( world, rows, cols, r - 1 + i, c + 1 );
+    } else {
+      sight[i] = worldCell( world, rows, cols, r + 1 - i, c - 1 );
+    }
+  }
+  sight[3] = '\0';
+}
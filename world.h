@@ -0,0 +1,45 @@
+/**
+   @file world.h
+   @author Louis Warner (elwarner)
+   This file contains declarations of helper functions for loading a known world grid
+   and deriving the sight strips the player would see in it. These functions are defined in world.c.
+ */
+
+/**
+   This function reads a world grid from the given file. Each line is one row made of '.', '#' and
+   lower-case letters, and exactly one '^' marks the starting cell of the player (facing north).
+   Short rows are padded with walls.
+   @param FILE *fp - the world file
+   @param int *rows - set to the height of the world
+   @param int *cols - set to the width of the world
+   @param int *startRow - set to the row of the starting cell
+   @param int *startCol - set to the column of the starting cell
+   @return char **world - the world grid, or NULL if the file is not a valid world
+ */
+char **loadWorld( FILE *fp, int *rows, int *cols, int *startRow, int *startCol );
+
+
+/**
+   This function returns the contents of one world cell. Everything outside the grid is a wall.
+   @param char **world - the world grid
+   @param int rows - height of the world
+   @param int cols - width of the world
+   @param int r - row of the cell
+   @param int c - column of the cell
+   @return char cell - contents of the cell
+ */
+char worldCell( char **world, int rows, int cols, int r, int c );
+
+
+/**
+   This function fills in the 3-character sight strip a player at the given world cell sees
+   when facing the given direction, in the same left-to-right order as a script line.
+   @param char **world - the world grid
+   @param int rows - height of the world
+   @param int cols - width of the world
+   @param int r - row of the player
+   @param int c - column of the player
+   @param int dir - direction of the player (NORTH, SOUTH, EAST, or WEST)
+   @param char sight[4] - filled with the strip and a null terminator
+ */
+void worldSight( char **world, int rows, int cols, int r, int c, int dir, char sight[4] );